@@ -0,0 +1,59 @@
+//-------------------------------------------------------------------------------------------------
+//
+// File: arena.cpp   Author: Dennis Lang  Desc: Scan lifetime bump allocator.
+//
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2024
+// https://landenlabs.com
+//
+// This file is part of lldup project.
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "arena.hpp"
+
+#include <algorithm>
+
+// ---------------------------------------------------------------------------
+// Start a new block, blocks double up to MAX_BLOCK, a larger request gets its own block.
+void* Arena::allocateBlock(size_t bytes, size_t align) {
+    size_t blockLen = std::max(std::min(MAX_BLOCK, std::max(MIN_BLOCK, reservedBytes)), bytes + align);
+    char* block = new char[blockLen];
+    blocks.push_back(block);
+    reservedBytes += blockLen;
+    blockPtr = block;
+    blockFree = blockLen;
+    return allocate(bytes, align);
+}
+
+// ---------------------------------------------------------------------------
+void Arena::release() {
+    for (char* block : blocks)
+        delete[] block;
+    blocks.clear();
+    blockPtr = nullptr;
+    blockFree = 0;
+    allocCnt = 0;
+    usedBytes = 0;
+    reservedBytes = 0;
+}
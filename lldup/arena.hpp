@@ -0,0 +1,134 @@
+//-------------------------------------------------------------------------------------------------
+// File: arena.hpp    Author: Dennis Lang
+//
+// Desc: Scan lifetime bump allocator. Allocations are carved from large blocks and never
+//       freed one by one, release() (or the destructor) returns every block in one shot.
+//
+// Usage::
+//
+//      Arena arena;
+//      const char* name = arena.copy(str, len);
+//      std::vector<int, ArenaAlloc<int>> list(ArenaAlloc<int>(arena));
+//
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2024
+// https://landenlabs.com
+//
+// This file is part of lldup project.
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <string.h>
+
+class Arena {
+public:
+    Arena() {}
+    ~Arena() {
+        release();
+    }
+
+    void* allocate(size_t bytes, size_t align = alignof(std::max_align_t)) {
+        size_t pad = (align - ((size_t)blockPtr & (align - 1))) & (align - 1);
+        if (pad + bytes > blockFree)
+            return allocateBlock(bytes, align);
+        char* result = blockPtr + pad;
+        blockPtr += pad + bytes;
+        blockFree -= pad + bytes;
+        allocCnt++;
+        usedBytes += bytes;
+        return result;
+    }
+
+    // Copy str and add terminator.
+    char* copy(const char* str, size_t len) {
+        char* result = (char*)allocate(len + 1, 1);
+        memcpy(result, str, len);
+        result[len] = '\0';
+        return result;
+    }
+
+    // Free every block, memory handed out becomes invalid.
+    void release();
+
+    size_t allocations() const {
+        return allocCnt;
+    }
+    size_t used() const {
+        return usedBytes;
+    }
+    size_t reserved() const {
+        return reservedBytes;
+    }
+    size_t blockCount() const {
+        return blocks.size();
+    }
+
+private:
+    static const size_t MIN_BLOCK = 4096;
+    static const size_t MAX_BLOCK = 1 << 20;
+
+    std::vector<char*> blocks;
+    char*  blockPtr = nullptr;
+    size_t blockFree = 0;
+    size_t allocCnt = 0;
+    size_t usedBytes = 0;
+    size_t reservedBytes = 0;
+
+    void* allocateBlock(size_t bytes, size_t align);
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+};
+
+// Standard allocator over an Arena, deallocate is a no-op.
+template <class TT>
+class ArenaAlloc {
+public:
+    typedef TT value_type;
+
+    Arena* arena;
+
+    ArenaAlloc(Arena& _arena) : arena(&_arena) {}
+    template <class UU>
+    ArenaAlloc(const ArenaAlloc<UU>& other) : arena(other.arena) {}
+
+    TT* allocate(size_t count) {
+        return (TT*)arena->allocate(count * sizeof(TT), alignof(TT));
+    }
+    void deallocate(TT*, size_t) {
+    }
+
+    template <class UU>
+    bool operator==(const ArenaAlloc<UU>& other) const {
+        return arena == other.arena;
+    }
+    template <class UU>
+    bool operator!=(const ArenaAlloc<UU>& other) const {
+        return arena != other.arena;
+    }
+};
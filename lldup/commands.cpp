@@ -38,7 +38,9 @@
 #include <stdio.h>
 #include <errno.h>
 #include <map>
+#include <set>
 #include <vector>
+#include <algorithm>
 
 #include "ll_stdhdr.hpp"
 #include "commands.hpp"
@@ -289,21 +291,10 @@ lstring& removeExtn(lstring& outName, const lstring& inPath) {
 
 // ---------------------------------------------------------------------------
 // Return true if inName matches pattern in patternList
-bool FileMatches(const lstring& inName, const PatternList& patternList, bool emptyResult) {
+static bool FileMatches(std::string_view inName, const PatternList& patternList, bool emptyResult) {
     if (patternList.empty() || inName.empty())
         return emptyResult;
-
-    for (size_t idx = 0; idx != patternList.size(); idx++)
-        if (std::regex_match(inName.begin(), inName.end(), patternList[idx]))
-            return true;
-
-    return false;
-}
-
-// ---------------------------------------------------------------------------
-static size_t fileLength(const lstring& path) {
-    struct stat info;
-    return (stat(path, &info) == 0) ? info.st_size : -1;
+    return patternList.matches(inName);
 }
 
 // ---------------------------------------------------------------------------
@@ -334,7 +325,9 @@ static struct stat  print(const lstring& path, struct stat* pInfo) {
 #if defined(_WIN32) || defined(_WIN64)
             bool isSymLink = false;
 #else
-            bool isSymLink = S_ISLNK(pInfo->st_flags);
+            // Link type is in the link's own mode, stat() above describes its target.
+            struct stat linkInfo;
+            bool isSymLink = lstat(path, &linkInfo) == 0 && S_ISLNK(linkInfo.st_mode);
 #endif
             std::cout << std::setw(8) << pInfo->st_size
                 << " " << timeBuf << " "
@@ -368,82 +361,173 @@ bool deleteFile(const char* path) {
 }
 
 // ---------------------------------------------------------------------------
-bool Command::validFile(const lstring& name)  {
-    bool isValid = (! name.empty()
+bool Command::validFile(std::string_view name)  {
+    bool isValid = isValidName(name);
+    if (! isValid)
+        skipCnt++;
+    return isValid;
+}
+
+// ---------------------------------------------------------------------------
+bool Command::isValidName(std::string_view name) const {
+    return (! name.empty()
         && ! FileMatches(name, excludeFilePatList, false)
         && FileMatches(name, includeFilePatList, true));
+}
+
+// ---------------------------------------------------------------------------
+// Return false if subdirectory name is pruned, its subtree is not walked.
+bool Command::validDir(std::string_view name)  {
+    bool isValid = isValidDirName(name);
+    if (! isValid)
+        pruneCnt++;
+    return isValid;
+}
+
+// ---------------------------------------------------------------------------
+bool Command::isValidDirName(std::string_view name) const {
+    return ! FileMatches(name, excludeDirPatList, false)
+        && FileMatches(name, includeDirPatList, true);
+}
+
+// ---------------------------------------------------------------------------
+// Return false if subdirectory dirPath on device dev is a mount point the walk
+// must not enter, -xdev or a -skipFs type. Checked before the directory is opened.
+bool Command::validMount(const char* dirPath, uint64_t dev, uint64_t parentDev) {
+    bool isValid = isValidMount(dirPath, dev, parentDev);
+    if (! isValid)
+        pruneCnt++;
+    return isValid;
+}
+
+// ---------------------------------------------------------------------------
+bool Command::isValidMount(const char* dirPath, uint64_t dev, uint64_t parentDev) const {
+    if (dev == parentDev)
+        return true;    // not a mount point, types only change across one
+    if (xdev)
+        return false;
+    lstring fsType;
+    DirUtil::fileSystemType(fsType, dirPath);
+    return fsType.empty() || std::find(skipFsTypes.begin(), skipFsTypes.end(), fsType) == skipFsTypes.end();
+}
+
+// ---------------------------------------------------------------------------
+// Return false if file length or modify time is outside the -minSize/-maxSize
+// and -newer/-older range, checked before the file is stored.
+bool Command::validInfo(uint64_t size, time_t mtime) {
+    bool isValid = isValidInfo(size, mtime);
     if (! isValid)
         skipCnt++;
     return isValid;
 }
 
+// ---------------------------------------------------------------------------
+bool Command::isValidInfo(uint64_t size, time_t mtime) const {
+    return size != NO_SIZE
+        && size >= minSize && size <= maxSize
+        && (newerThan == 0 || mtime >= newerThan)
+        && (olderThan == 0 || mtime < olderThan);
+}
+
+// ---------------------------------------------------------------------------
+// Default batch passes each file's full path to add().
+size_t Command::addBatch(PathBuf& dirPath, const Entry* entries, size_t count) {
+    size_t fileCount = 0;
+    for (size_t idx = 0; idx < count; idx++) {
+        nameBuf.assign(entries[idx].name.data(), entries[idx].name.length());
+        size_t mark = dirPath.push(nameBuf);
+        pathBuf.assign(dirPath.str());
+        fileCount += add(pathBuf, entries[idx].dirId);
+        dirPath.truncate(mark);
+    }
+    return fileCount;
+}
+
 // ---------------------------------------------------------------------------
 // Locate matching files which are not in exclude list.
 // Locate pair of files one encrypt with AXX and the native file
 //  foo-xls.axx and foo.xls
 //  Decrypt the axx and compare to native.
 size_t DupDecode::add(const lstring& fullname) {
-    size_t fileCount = 0;
     lstring name;
     getName(name, fullname);
+    return validFile(name) ? addValid(fullname, name) : 0;
+}
+
+// ---------------------------------------------------------------------------
+// Filter on name, full path is only built for files which pass.
+size_t DupDecode::addBatch(PathBuf& dirPath, const Entry* entries, size_t count) {
+    size_t fileCount = 0;
+    for (size_t idx = 0; idx < count; idx++) {
+        nameBuf.assign(entries[idx].name.data(), entries[idx].name.length());
+        if (validFile(nameBuf)) {
+            size_t mark = dirPath.push(nameBuf);
+            pathBuf.assign(dirPath.str());
+            fileCount += addValid(pathBuf, nameBuf);
+            dirPath.truncate(mark);
+        }
+    }
+    return fileCount;
+}
 
-    if (validFile(name)) {
-        const lstring DECRYPT_CMD = quote(DECRYPT_EXE) + " -f -c -k " + quote(DECRYPT_KEY) + " -d -n ";
-        const lstring OUTFILE = "d:\\out";
-
-        if (name.find(AXX) != lstring::npos) {   //  chry-towncountry-2007-xlsx.axx
-            lstring dup1 = fullname;
-            lstring dup2 = lstring(fullname);
-            ReplaceAll(dup2, AXX, EMPTY);
-            size_t pos = dup2.find_last_of("-");
-            if (pos + 3 <= dup2.length()) {
-                dup2[pos] = '.';
-                lstring extn = dup2 + pos;
-
-                struct stat info1;
-                struct stat info2;
-
-                int result1 = stat(dup1.c_str(), &info1);
-                int result2 = stat(dup2.c_str(), &info2);
-
-                if (result1 == 0 && result2 == 0) {
-                    print(dup1, &info1);
-                    print(dup2, &info2);
-
-                    lstring outFile = OUTFILE + extn;
-                    lstring decrypCmd = DECRYPT_CMD + outFile + " " + quote(dup1);
-                    DWORD exitCode = 0;
-
-                    deleteFile(outFile);
-                    if (RunCommand(decrypCmd, &exitCode, 2000)) {
-                        if (exitCode == 0) {
-                            struct stat info3 = print(outFile, NULL);
-                            if (info3.st_size == info2.st_size) {
-                                lstring compare = "D:\\opt\\bin\\cmp.exe -q ";
-                                lstring cmpCmd = compare + quote(dup2) + " " + quote(outFile);
-                                if (RunCommand(cmpCmd, &exitCode, 2000)) {
-                                    if (exitCode == 0) {
-                                        std::cout << "  Identical\n";
-                                        std::cout << "lr -f " << quote(dup2) << std::endl;
-                                    }
-                                } else {
-                                    std::cout << "Compare execute failed " << exitCode << std::endl;
+// ---------------------------------------------------------------------------
+size_t DupDecode::addValid(const lstring& fullname, const lstring& name) {
+    size_t fileCount = 0;
+    const lstring DECRYPT_CMD = quote(DECRYPT_EXE) + " -f -c -k " + quote(DECRYPT_KEY) + " -d -n ";
+    const lstring OUTFILE = "d:\\out";
+
+    if (name.find(AXX) != lstring::npos) {   //  chry-towncountry-2007-xlsx.axx
+        lstring dup1 = fullname;
+        lstring dup2 = lstring(fullname);
+        ReplaceAll(dup2, AXX, EMPTY);
+        size_t pos = dup2.find_last_of("-");
+        if (pos + 3 <= dup2.length()) {
+            dup2[pos] = '.';
+            lstring extn = dup2 + pos;
+
+            struct stat info1;
+            struct stat info2;
+
+            int result1 = stat(dup1.c_str(), &info1);
+            int result2 = stat(dup2.c_str(), &info2);
+
+            if (result1 == 0 && result2 == 0) {
+                print(dup1, &info1);
+                print(dup2, &info2);
+
+                lstring outFile = OUTFILE + extn;
+                lstring decrypCmd = DECRYPT_CMD + outFile + " " + quote(dup1);
+                DWORD exitCode = 0;
+
+                deleteFile(outFile);
+                if (RunCommand(decrypCmd, &exitCode, 2000)) {
+                    if (exitCode == 0) {
+                        struct stat info3 = print(outFile, NULL);
+                        if (info3.st_size == info2.st_size) {
+                            lstring compare = "D:\\opt\\bin\\cmp.exe -q ";
+                            lstring cmpCmd = compare + quote(dup2) + " " + quote(outFile);
+                            if (RunCommand(cmpCmd, &exitCode, 2000)) {
+                                if (exitCode == 0) {
+                                    std::cout << "  Identical\n";
+                                    std::cout << "lr -f " << quote(dup2) << std::endl;
                                 }
+                            } else {
+                                std::cout << "Compare execute failed " << exitCode << std::endl;
                             }
-                        } else {
-                            std::cout << decrypCmd << " ExitCode=" << exitCode << std::endl;
                         }
+                    } else {
+                        std::cout << decrypCmd << " ExitCode=" << exitCode << std::endl;
                     }
-                    std::cout << std::endl;
                 }
+                std::cout << std::endl;
             }
         }
+    }
 
-        fileCount++;
-        if (showFile)
-            std::cout << fullname.c_str() << std::endl;
+    fileCount++;
+    if (showFile)
+        std::cout << fullname.c_str() << std::endl;
 
-    }
 
     return fileCount;
 }
@@ -472,131 +556,167 @@ bool CompareAxxPair::begin(StringList& fileDirList) {
 // Decrypt and compare
 //   path1/foo-xls.axx  path2/foo-xls.axx
 size_t CompareAxxPair::add(const lstring& fullname) {
-    size_t fileCount = 0;
     lstring name;
     getName(name, fullname);
+    return validFile(name) ? addValid(fullname, name) : 0;
+}
 
-    if (validFile(name)) {
-        const lstring DECRYPT_CMD = quote(DECRYPT_EXE) + " -f -c -k " + quote(DECRYPT_KEY) + " -d -n ";
-        const lstring OUTFILE1 = "d:\\out1";
-        const lstring OUTFILE2 = "d:\\out2";
-        // const lstring COPY_CMD = "cmd /c copy /y ";
-        const lstring COPY_CMD = "d:\\opt\\bin\\lc -vfO ";
-        Decrypt decrypt1(DECRYPT_CMD);
-        Decrypt decrypt2(DECRYPT_CMD);
-
-        if (name.find(AXX) != lstring::npos) {   //  chry-towncountry-2007-xlsx.axx
-            if (decrypt1.decryptFile(fullname, OUTFILE1)) {
-                lstring file2 = fullname;
-                ReplaceAll(file2, ref1Path, ref2Path);
-                if (decrypt2.decryptFile(file2, OUTFILE2)) {
-                    fileCount++;
-                    print(decrypt1.path, &decrypt1.outStat);
-                    print(decrypt2.path, &decrypt2.outStat);
-
-                    lstring compare = "D:\\opt\\bin\\cmp.exe -q ";
-                    lstring cmpCmd = compare + quote(decrypt1.outFile) + " " + quote(decrypt2.outFile);
-                    DWORD exitCode = 0;
-                    if (RunCommand(cmpCmd, &exitCode, 2000)) {
-                        if (exitCode == 0) {
-                            std::cout << "  Identical\n";
-                            if (true) {
-                                // std::cout << "lr -f " << quote(decrypt2.path) << std::endl;
-                                lstring copyCmd = COPY_CMD + quote(fullname) + " " + quote(file2);
-                                std::cout << copyCmd << std::endl;
-                                if (RunCommand(copyCmd, &exitCode, 2000)) {
-                                } else {
-                                    std::cerr << "Copy execute failed " << exitCode << std::endl;
-                                }
+// ---------------------------------------------------------------------------
+// Filter on name, full path is only built for files which pass.
+size_t CompareAxxPair::addBatch(PathBuf& dirPath, const Entry* entries, size_t count) {
+    size_t fileCount = 0;
+    for (size_t idx = 0; idx < count; idx++) {
+        nameBuf.assign(entries[idx].name.data(), entries[idx].name.length());
+        if (validFile(nameBuf)) {
+            size_t mark = dirPath.push(nameBuf);
+            pathBuf.assign(dirPath.str());
+            fileCount += addValid(pathBuf, nameBuf);
+            dirPath.truncate(mark);
+        }
+    }
+    return fileCount;
+}
+
+// ---------------------------------------------------------------------------
+size_t CompareAxxPair::addValid(const lstring& fullname, const lstring& name) {
+    size_t fileCount = 0;
+    const lstring DECRYPT_CMD = quote(DECRYPT_EXE) + " -f -c -k " + quote(DECRYPT_KEY) + " -d -n ";
+    const lstring OUTFILE1 = "d:\\out1";
+    const lstring OUTFILE2 = "d:\\out2";
+    // const lstring COPY_CMD = "cmd /c copy /y ";
+    const lstring COPY_CMD = "d:\\opt\\bin\\lc -vfO ";
+    Decrypt decrypt1(DECRYPT_CMD);
+    Decrypt decrypt2(DECRYPT_CMD);
+
+    if (name.find(AXX) != lstring::npos) {   //  chry-towncountry-2007-xlsx.axx
+        if (decrypt1.decryptFile(fullname, OUTFILE1)) {
+            lstring file2 = fullname;
+            ReplaceAll(file2, ref1Path, ref2Path);
+            if (decrypt2.decryptFile(file2, OUTFILE2)) {
+                fileCount++;
+                print(decrypt1.path, &decrypt1.outStat);
+                print(decrypt2.path, &decrypt2.outStat);
+
+                lstring compare = "D:\\opt\\bin\\cmp.exe -q ";
+                lstring cmpCmd = compare + quote(decrypt1.outFile) + " " + quote(decrypt2.outFile);
+                DWORD exitCode = 0;
+                if (RunCommand(cmpCmd, &exitCode, 2000)) {
+                    if (exitCode == 0) {
+                        std::cout << "  Identical\n";
+                        if (true) {
+                            // std::cout << "lr -f " << quote(decrypt2.path) << std::endl;
+                            lstring copyCmd = COPY_CMD + quote(fullname) + " " + quote(file2);
+                            std::cout << copyCmd << std::endl;
+                            if (RunCommand(copyCmd, &exitCode, 2000)) {
+                            } else {
+                                std::cerr << "Copy execute failed " << exitCode << std::endl;
                             }
                         }
-                    } else {
-                        if (exitCode <= 10)
-                            std::cout << "Compare execute failed " << exitCode << std::endl;
-                        else
-                            std::cout << "Compare execute failed " << exitCode
-                                << " " << GetErrorMsg(exitCode) << std::endl;
-
                     }
+                } else {
+                    if (exitCode <= 10)
+                        std::cout << "Compare execute failed " << exitCode << std::endl;
+                    else
+                        std::cout << "Compare execute failed " << exitCode
+                            << " " << GetErrorMsg(exitCode) << std::endl;
+
                 }
             }
         }
-
-        if (showFile)
-            std::cout << fullname.c_str() << std::endl;
     }
 
+    if (showFile)
+        std::cout << fullname.c_str() << std::endl;
+
     return fileCount;
 }
 
 
 
-// map<std::string name, vector<int> path>
-
-map<std::string, IntList> fileList;
-std::vector<std::string> pathList;
-std::string lastPath;
-unsigned lastPathIdx = 0;
-
 // ---------------------------------------------------------------------------
 bool DupFiles::begin(StringList& fileDirList) {
-    fileList.clear();
-    pathList.clear();
-    lastPathIdx = 0;
+    fileStore.clear();
     return true;
 }
 
+// ---------------------------------------------------------------------------
+// A root is stored by its full path, the same form Directory_files uses for its entries.
+unsigned DupFiles::addDir(unsigned parentId, const lstring& dirName) {
+    if (parentId != NO_DIR)
+        return fileStore.addDir(parentId, dirName);
+
+    lstring rootPath;
+    if (! DirUtil::fileExists(dirName))
+        DirUtil::getDir(rootPath, dirName);    // remove wildcard
+    else
+        rootPath = dirName;
+    DirUtil::fullPath(rootPath, rootPath);
+    return fileStore.addRoot(rootPath);
+}
+
+// ---------------------------------------------------------------------------
+// File given directly, its directory becomes a root.
+size_t DupFiles::add(const lstring& fullname) {
+    lstring dirPath;
+    DirUtil::getDir(dirPath, fullname);
+    return add(fullname, addDir(NO_DIR, dirPath));
+}
+
 // ---------------------------------------------------------------------------
 // Locate matching files which are not in exclude list.
 // Locate duplcate files.
-size_t DupFiles::add(const lstring& fullname) {
+size_t DupFiles::add(const lstring& fullname, unsigned dirId) {
     size_t fileCount = 0;
-    lstring name;
-    getName(name, fullname);
+    size_t nameStart = fullname.rfind(SLASH_CHAR) + 1;
+    nameBuf.assign(fullname, nameStart, lstring::npos);     // reused, no allocation per file
 
-    if (validFile(name)) {
-        std::string path = fullname.substr(0, fullname.length() - name.length());
-        if (lastPath != path) {
-            if (lastPath.rfind(path, 0) == 0) {
-                for (lastPathIdx--; lastPathIdx < pathList.size(); lastPathIdx--) {
-                    lastPath = pathList[lastPathIdx];
-                    if (lastPath == path) {
-                        break;
-                    }
-                }
-            } else {
-                lastPathIdx = -1;
-            }
+    if (validFile(nameBuf)) {
+        fileStore.add(nameBuf, dirId);
+        fileCount = 1;
+    }
 
-            if (lastPathIdx >= pathList.size() ) {
-                lastPathIdx = (unsigned)pathList.size();
-                lastPath = path;
-                pathList.push_back(lastPath);
-            }
+    return fileCount;
+}
 
-            string testPath = pathList[lastPathIdx] + name;
-            if (testPath != fullname) {
-                assert(false);
-            }
+// ---------------------------------------------------------------------------
+// Index a directory's files without building their paths, size and inode come
+// from the listing when needInfo() asked for them.
+size_t DupFiles::addBatch(PathBuf& /*dirPath*/, const Entry* entries, size_t count) {
+    size_t fileCount = 0;
+    for (size_t idx = 0; idx < count; idx++) {
+        const Entry& entry = entries[idx];
+        if (validFile(entry.name)) {
+            if (needInfo())
+                fileStore.add(entry.name, entry.dirId, entry.size, entry.dev, entry.ino);
+            else
+                fileStore.add(entry.name, entry.dirId);
+            if (entry.hashKind != HASH_NONE)
+                fileStore.setHash((uint32_t)fileStore.size() - 1, entry.hash, entry.hashKind);
+            fileCount++;
         }
-        fileList[name].push_back(lastPathIdx);
-        fileCount = 1;
     }
-
     return fileCount;
 }
 
-class PathParts {
-public:
-    unsigned pathIdx;
-    const string& name;
-    PathParts(unsigned _pathIdx, const string& _name) :
-        pathIdx(_pathIdx), name(_name) {}
-};
+// ---------------------------------------------------------------------------
+// Return the kind of known hash every record of order[pos, endPos) has, so a group
+// covered by one manifest is compared without reading. Mixed or missing kinds give
+// HASH_XXH64, what reading a file computes.
+HashKind DupFiles::groupHashKind(const std::vector<uint32_t>& order, size_t pos, size_t endPos) const {
+    if (fileStore.hashKinds.empty())
+        return HASH_XXH64;
+    HashKind kind = fileStore.hashKind(order[pos]);
+    while (++pos < endPos) {
+        if (fileStore.hashKind(order[pos]) != kind)
+            return HASH_XXH64;
+    }
+    return (kind == HASH_NONE) ? HASH_XXH64 : kind;
+}
 
-void DupFiles::printPaths(const IntList& pathListIdx, const std::string& name) {
-    for (unsigned plIdx = 0; plIdx < pathListIdx.size(); plIdx++) {
-        lstring fullPath = pathList[pathListIdx[plIdx]] + name;
+// ---------------------------------------------------------------------------
+void DupFiles::printPaths(const IntList& dirIds, const char* name) {
+    for (unsigned plIdx = 0; plIdx < dirIds.size(); plIdx++) {
+        lstring fullPath = fileStore.path(dirIds[plIdx], name);
         if (verbose) {
             print(fullPath, NULL);
         } else {
@@ -606,19 +726,200 @@ void DupFiles::printPaths(const IntList& pathListIdx, const std::string& name) {
     }
 }
 
+// ---------------------------------------------------------------------------
+// Directory node used to build directory content digests bottom-up, one per FileStore dir.
+class DirNode {
+public:
+    typedef std::pair<const char*, uint64_t> Child;     // pooled name and file hash or directory digest
+
+    uint64_t digest = 0;
+    unsigned fileCnt = 0;       // files in subtree
+    bool unique = false;        // holds a file whose size occurs once, cannot have a duplicate
+    bool dup = false;           // digest shared with another directory
+    bool hidden = false;        // reported as part of a duplicate directory
+    std::vector<Child, ArenaAlloc<Child>> children;
+
+    DirNode(Arena& arena) : children(ArenaAlloc<Child>(arena)) {}
+
+    static bool less(const Child& lhs, const Child& rhs) {
+        int diff = strcmp(lhs.first, rhs.first);
+        return diff < 0 || (diff == 0 && lhs.second < rhs.second);
+    }
+};
+
+// ---------------------------------------------------------------------------
+// Report directories with identical content as one group and remember which group holds
+// each directory, so dropDupDirFiles() hides the per-file groups under them.
+// Digest of a directory is computed bottom-up from its sorted (name, hash) children.
+void DupFiles::findDupDirs() {
+    typedef uint64_t HashValue;         // xxHash64
+
+    // 1. Node per directory, parents precede children in fileStore.dirs.
+    const std::vector<DirRec>& dirs = fileStore.dirs;
+    std::vector<DirNode> nodes(dirs.size(), DirNode(groupArena));
+    dupDirGroup.assign(dirs.size(), FileStore::NO_DIR);
+    dupDirTop.assign(dirs.size(), FileStore::NO_DIR);
+    auto parentOf = [&](size_t idx) { return (dirs[idx].parentId == FileStore::NO_DIR) ? -1 : (int)dirs[idx].parentId; };
+
+    // 2. A file whose size occurs once cannot be in a duplicate directory.
+    if (! fileStore.hasStat())
+        fileStore.statFiles();
+    const std::vector<uint64_t>& sizes = fileStore.sizes;
+    std::vector<uint32_t> sizeOrder(fileStore.size());
+    for (uint32_t rec = 0; rec < sizeOrder.size(); rec++)
+        sizeOrder[rec] = rec;
+    FileStore::radixSort(sizeOrder, sizes);
+    for (size_t pos = 0; pos < sizeOrder.size(); pos++) {
+        uint64_t size = sizes[sizeOrder[pos]];
+        if ((pos == 0 || sizes[sizeOrder[pos - 1]] != size) && (pos + 1 == sizeOrder.size() || sizes[sizeOrder[pos + 1]] != size))
+            nodes[fileStore.dirIds[sizeOrder[pos]]].unique = true;
+    }
+
+    // 3. Hash files of candidate directories, children are sorted by name below.
+    //    Hashes are kept in fileStore so the file pass does not read them again.
+    lstring fullPath;
+    for (uint32_t rec = 0; rec < fileStore.size(); rec++) {
+        DirNode& node = nodes[fileStore.dirIds[rec]];
+        HashValue hashValue = 0;
+        if (node.unique) {
+            // cannot match, not read
+        } else if (fileStore.hashKind(rec) == HASH_XXH64) {
+            hashValue = fileStore.hashes[rec];
+        } else if (fileStore.hashKind(rec) == HASH_NONE) {
+            hashValue = XXHash64::compute(fileStore.filePath(fullPath, rec));
+            fileStore.setHash(rec, hashValue, HASH_XXH64);
+        } else {
+            hashValue = XXHash64::compute(fileStore.filePath(fullPath, rec));
+        }
+        node.children.emplace_back(fileStore.name(rec), hashValue ^ sizes[rec]);
+        node.fileCnt++;
+    }
+
+    // 4. Bottom-up, children always follow their parent.
+    for (size_t idx = nodes.size(); idx-- != 0; ) {
+        DirNode& node = nodes[idx];
+        std::sort(node.children.begin(), node.children.end(), DirNode::less);
+        XXHash64 hasher(0);
+        for (const auto& child : node.children) {
+            hasher.add(child.first, strlen(child.first) + 1);
+            hasher.add(&child.second, sizeof(child.second));
+        }
+        node.digest = hasher.hash();
+        node.children.clear();
+
+        if (parentOf(idx) >= 0) {
+            DirNode& parent = nodes[parentOf(idx)];
+            parent.children.emplace_back(fileStore.dirName((uint32_t)idx), node.digest);
+            parent.fileCnt += node.fileCnt;
+            parent.unique |= node.unique;
+        }
+    }
+
+    // 5. Group directories by digest, each run of equal digest in digestOrder is one group.
+    std::vector<uint64_t> digests(nodes.size());
+    std::vector<uint32_t> digestOrder;
+    for (uint32_t idx = 0; idx < nodes.size(); idx++) {
+        digests[idx] = nodes[idx].digest;
+        if (! nodes[idx].unique && nodes[idx].fileCnt != 0)
+            digestOrder.push_back(idx);
+    }
+    FileStore::radixSort(digestOrder, digests);
+    auto digestRun = [&](size_t pos) {
+        size_t endPos = pos + 1;
+        while (endPos < digestOrder.size() && digests[digestOrder[endPos]] == digests[digestOrder[pos]])
+            endPos++;
+        return endPos;
+    };
+    for (size_t pos = 0, endPos; pos < digestOrder.size(); pos = endPos) {
+        endPos = digestRun(pos);
+        for (size_t mIdx = pos; mIdx < endPos; mIdx++)
+            nodes[digestOrder[mIdx]].dup = (endPos - pos > 1);
+    }
+
+    // 6. Report groups holding a top-most duplicate, hide everything below them.
+    lstring dirPath;
+    for (size_t pos = 0, endPos; pos < digestOrder.size(); pos = endPos) {
+        endPos = digestRun(pos);
+        bool topMost = false;
+        for (size_t mIdx = pos; mIdx < endPos; mIdx++) {
+            int idx = digestOrder[mIdx];
+            topMost |= endPos - pos > 1 && (parentOf(idx) < 0 || ! nodes[parentOf(idx)].dup);
+        }
+        if (! topMost)
+            continue;
+
+        std::cout << preDivider;
+        for (size_t mIdx = pos; mIdx < endPos; mIdx++) {
+            DirNode& node = nodes[digestOrder[mIdx]];
+            node.hidden = true;
+            dupDirGroup[digestOrder[mIdx]] = (uint32_t)pos;
+            dupDirTop[digestOrder[mIdx]] = digestOrder[mIdx];
+            if (mIdx != pos) std::cout << separator;
+            if (verbose) std::cout << "Files " << node.fileCnt << " ";
+            std::cout << fileStore.dirPath(dirPath, digestOrder[mIdx]);
+        }
+        std::cout << postDivider;
+    }
+    // 7. Directories below a reported one belong to its group, parents precede children.
+    for (size_t idx = 0; idx < nodes.size(); idx++) {
+        if (parentOf(idx) >= 0 && nodes[parentOf(idx)].hidden) {
+            nodes[idx].hidden = true;
+            dupDirGroup[idx] = dupDirGroup[parentOf(idx)];
+            dupDirTop[idx] = dupDirTop[parentOf(idx)];
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Hide the members of a duplicate file group that sit under directories -dupDirs reported,
+// keeping one copy per directory group and path below it. Return false if the group is
+// no longer shown, all its members are under reported directories.
+bool DupFiles::dropDupDirFiles(std::vector<uint32_t>& recs) const {
+    if (dupDirGroup.empty() || invert)
+        return recs.size() > 1 || invert;
+    bool outside = false;
+    for (uint32_t rec : recs)
+        outside |= dupDirGroup[fileStore.dirIds[rec]] == FileStore::NO_DIR;
+    if (! outside)
+        return false;
+
+    std::set<std::pair<uint32_t, lstring>> shown;
+    lstring filePath, topPath;
+    size_t keepCnt = 0;
+    for (uint32_t rec : recs) {
+        uint32_t dirId = fileStore.dirIds[rec];
+        if (dupDirGroup[dirId] != FileStore::NO_DIR) {
+            fileStore.filePath(filePath, rec);
+            fileStore.dirPath(topPath, dupDirTop[dirId]);
+            if (! shown.emplace(dupDirGroup[dirId], filePath.substr(topPath.length())).second)
+                continue;   // same file of another copy of the directory
+        }
+        recs[keepCnt++] = rec;
+    }
+    recs.resize(keepCnt);
+    return keepCnt > 1;
+}
+
 // ---------------------------------------------------------------------------
 bool DupFiles::end() {
     // typedef lstring HashValue;       // md5
     typedef uint64_t HashValue;         // xxHash64
 
+    if (dupDirs && ! justName)
+        findDupDirs();
+
+    // Each run of equal name in nameOrder is one name group.
+    std::vector<uint32_t> nameOrder;
+    fileStore.byName(nameOrder);
+    IntList dirIds;
+
     if (justName && ignoreExtn) {
         lstring noExtn;
-        std::map<lstring, std::vector<const string* >> noExtnList;       // TODO - make string& not string
-        for (auto it = fileList.cbegin(); it != fileList.cend(); it++) {
-            const string& fullname = it->first;
-            getName(noExtn, fullname);
+        std::map<lstring, std::vector<size_t>> noExtnList;     // first nameOrder position of each name
+        for (size_t pos = 0; pos < nameOrder.size(); pos = fileStore.nameRun(nameOrder, pos)) {
+            getName(noExtn, fileStore.name(nameOrder[pos]));
             removeExtn(noExtn, noExtn);
-            noExtnList[noExtn].push_back(&fullname);
+            noExtnList[noExtn].push_back(pos);
         }
 
         for (auto it = noExtnList.cbegin(); it != noExtnList.cend(); it++) {
@@ -626,47 +927,50 @@ bool DupFiles::end() {
             if (it->second.size() > 1) {
 
                 for (auto itNames = it->second.cbegin(); itNames != it->second.cend(); itNames++) {
-                    const IntList& pathListIdx = fileList[*(*itNames)];
+                    const char* name = fileStore.nameDirs(nameOrder, *itNames, dirIds);
                     if (outCnt == 0) std::cout << preDivider;
                     if (outCnt++ != 0) std::cout << separator;
-                    printPaths(pathListIdx, *(*itNames));
+                    printPaths(dirIds, name);
                 }
             }
             if (outCnt != 0) std::cout << postDivider;
         }
 
     } else if (justName) {
-        for (auto it = fileList.cbegin(); it != fileList.cend(); it++) {
-            const IntList& pathListIdx = it->second;
-            if (it->second.size() > 1) {
+        for (size_t pos = 0; pos < nameOrder.size(); pos = fileStore.nameRun(nameOrder, pos)) {
+            const char* name = fileStore.nameDirs(nameOrder, pos, dirIds);
+            if (dirIds.size() > 1) {
                 std::cout << preDivider;
-                printPaths(pathListIdx, it->first);
+                printPaths(dirIds, name);
                 std::cout << postDivider;
             }
         }
     } else if (sameName)  {
         std::map<HashValue, unsigned> hashDups;
         std::map<lstring, HashValue> fileHash;
-        for (auto it = fileList.cbegin(); it != fileList.cend(); it++) {
-            const IntList& pathListIdx = it->second;
-            if (it->second.size() > 1) {
+        for (size_t pos = 0; pos < nameOrder.size(); pos = fileStore.nameRun(nameOrder, pos)) {
+            const char* name = fileStore.nameDirs(nameOrder, pos, dirIds);
+            if (dirIds.size() > 1) {
                 hashDups.clear();
                 fileHash.clear();
+                HashKind groupKind = groupHashKind(nameOrder, pos, pos + dirIds.size());
 
-                for (unsigned plIdx = 0; plIdx < pathListIdx.size(); plIdx++) {
-                    // std::cout << pathList[pathListIdx[plIdx]] << it->first << std::endl;
-                    lstring fullPath = pathList[pathListIdx[plIdx]] + it->first;
+                for (unsigned plIdx = 0; plIdx < dirIds.size(); plIdx++) {
+                    // std::cout << fileStore.path(dirIds[plIdx], name) << std::endl;
+                    lstring fullPath = fileStore.path(dirIds[plIdx], name);
+                    uint32_t rec = nameOrder[pos + plIdx];     // nameDirs keeps nameOrder order
                     // HashValue hashValue = Md5::compute(fullPath);
-                    HashValue hashValue = XXHash64::compute(fullPath);
+                    HashValue hashValue = (fileStore.hashKind(rec) == groupKind)
+                        ? fileStore.hashes[rec] : XXHash64::compute(fullPath);
                     hashDups[hashValue] = hashDups[hashValue] + 1;
                     fileHash[fullPath] = hashValue;
                 }
 
-                std::map<HashValue, std::vector<unsigned >> hashFileList;
-                for (unsigned plIdx = 0; plIdx < pathListIdx.size(); plIdx++) {
-                    // std::cout << pathList[pathListIdx[plIdx]] << it->first << std::endl;
-                    unsigned plPos = pathListIdx[plIdx];
-                    lstring fullPath = pathList[plPos] + it->first;
+                std::map<HashValue, std::vector<uint32_t>> hashFileList;     // records by hash
+                for (unsigned plIdx = 0; plIdx < dirIds.size(); plIdx++) {
+                    // std::cout << fileStore.path(dirIds[plIdx], name) << std::endl;
+                    unsigned plPos = dirIds[plIdx];
+                    lstring fullPath = fileStore.path(plPos, name);
                     HashValue hashValue = fileHash[fullPath];
                     bool isDup = (hashDups[hashValue] != 1);
                     if (verbose) {
@@ -674,17 +978,17 @@ bool DupFiles::end() {
                         print(fullPath, NULL);
                         // std::cout << endl;
                     } else if (isDup != invert) {
-                        hashFileList[hashValue].push_back(plPos);
+                        hashFileList[hashValue].push_back(nameOrder[pos + plIdx]);
                     }
                 }
 
                 if (! verbose) {
-                    for (auto hashFileListIter = hashFileList.cbegin(); hashFileListIter != hashFileList.cend(); hashFileListIter++) {
-                        if (hashFileListIter->second.size() > 1) {
+                    for (auto hashFileListIter = hashFileList.begin(); hashFileListIter != hashFileList.end(); hashFileListIter++) {
+                        if (hashFileListIter->second.size() > 1 && dropDupDirFiles(hashFileListIter->second)) {
                             std::cout << preDivider;
                             const auto& matchList = hashFileListIter->second;
                             for (unsigned mIdx = 0; mIdx < matchList.size(); mIdx++) {
-                                string fullPath = pathList[matchList[mIdx]] + it->first;
+                                string fullPath = fileStore.path(matchList[mIdx]);
                                 if (mIdx != 0) std::cout << separator;
                                 std::cout << fullPath;
                             }
@@ -694,58 +998,67 @@ bool DupFiles::end() {
                 }
             } else if (invert) {
                 std::cout << preDivider;
-                lstring fullPath = pathList[pathListIdx[0]] + it->first;
+                lstring fullPath = fileStore.path(dirIds[0], name);
                 std::cout << fullPath << postDivider;
             }
         }
     } else {
         // Compare all files by size and hash
-        //  1. Create map of file length and name
-        //  2. For duplicate file length - compute hash
-        //  3. For duplicate hash print
-
-        // 1. Create map of file length and name
-        std::map<size_t, std::vector<PathParts >> sizeFileList;
-        for (auto it = fileList.cbegin(); it != fileList.cend(); it++) {
-            const IntList& pathListIdx = it->second;
-            for (unsigned plIdx = 0; plIdx < pathListIdx.size(); plIdx++) {
-                unsigned plPos = pathListIdx[plIdx];
-                lstring fullPath = pathList[plPos] + it->first;
-                size_t fileLen = fileLength(fullPath);
-                fileLen = (fileLen != 0) ? fileLen : std::hash<std::string> {}(fullPath);
-                const string& name = it->first;
-                PathParts pathParts(plPos, name);
-                sizeFileList[fileLen].push_back(pathParts);
-            }
-        }
+        //  1. Sort records by file length, radix sort keeps name order within a length
+        //  2. For duplicate file length - compute hash, hard links share one hash
+        //  3. Sort hashed records by hash and print duplicate runs
+
+        // 1. Sort by file length, empty files are never duplicates.
+        if (! fileStore.hasStat())
+            fileStore.statFiles();
+        const std::vector<uint64_t>& sizes = fileStore.sizes;
+        FileStore::radixSort(nameOrder, sizes);
 
         // 2. Compute hash on duplicate length files.
-        std::map<HashValue, std::vector<const PathParts* >> hashFileList;
-        for (auto sizeFileListIter = sizeFileList.cbegin(); sizeFileListIter != sizeFileList.cend(); sizeFileListIter++) {
-            if ((sizeFileListIter->second.size() > 1) != invert) {
-                const auto& sizeList = sizeFileListIter->second;
-                for (unsigned sIdx = 0; sIdx < sizeList.size(); sIdx++) {
-                    const PathParts& pathParts = sizeList[sIdx];
-                    lstring fullPath = pathList[pathParts.pathIdx];
-                    fullPath += pathParts.name;
-                    // HashValue hashValue = Md5::compute(fullPath);
-                    HashValue hashValue = XXHash64::compute(fullPath);
-                    hashFileList[hashValue].push_back(&pathParts);
+        std::vector<uint64_t>& hashes = fileStore.hashes;
+        hashes.resize(fileStore.size(), 0);     // keeps hashes known from manifests
+        std::vector<uint32_t> hashOrder;
+        typedef std::pair<const std::pair<uint64_t, uint64_t>, HashValue> LinkItem;
+        std::map<std::pair<uint64_t, uint64_t>, HashValue, std::less<>, ArenaAlloc<LinkItem>> linkHash{ArenaAlloc<LinkItem>(groupArena)};
+        lstring fullPath;
+        for (size_t pos = 0, endPos; pos < nameOrder.size(); pos = endPos) {
+            uint64_t size = sizes[nameOrder[pos]];
+            for (endPos = pos + 1; size != 0 && endPos < nameOrder.size() && sizes[nameOrder[endPos]] == size; endPos++);
+            if ((endPos - pos > 1) != invert) {
+                linkHash.clear();
+                HashKind groupKind = groupHashKind(nameOrder, pos, endPos);
+                for (size_t sIdx = pos; sIdx < endPos; sIdx++) {
+                    uint32_t rec = nameOrder[sIdx];
+                    std::pair<uint64_t, uint64_t> devIno(fileStore.devs[rec], fileStore.inos[rec]);
+                    auto found = (devIno.second != 0) ? linkHash.find(devIno) : linkHash.end();
+                    if (fileStore.hashKind(rec) == groupKind) {
+                        // known from a manifest or -dupDirs, not read
+                    } else if (found != linkHash.end()) {
+                        hashes[rec] = found->second;
+                    } else {
+                        // HashValue hashValue = Md5::compute(fullPath);
+                        hashes[rec] = XXHash64::compute(fileStore.filePath(fullPath, rec));
+                        if (devIno.second != 0)
+                            linkHash[devIno] = hashes[rec];
+                    }
+                    hashOrder.push_back(rec);
                 }
             }
         }
 
         // 3. Find duplicate hash
-        for (auto hashFileListIter = hashFileList.cbegin(); hashFileListIter != hashFileList.cend(); hashFileListIter++) {
-            if ((hashFileListIter->second.size() > 1) != invert) {
+        FileStore::radixSort(hashOrder, hashes);
+        std::vector<uint32_t> matchList;
+        for (size_t pos = 0, endPos; pos < hashOrder.size(); pos = endPos) {
+            HashValue hashValue = hashes[hashOrder[pos]];
+            for (endPos = pos + 1; endPos < hashOrder.size() && hashes[hashOrder[endPos]] == hashValue; endPos++);
+            matchList.assign(hashOrder.begin() + pos, hashOrder.begin() + endPos);
+            if ((endPos - pos > 1) != invert && dropDupDirFiles(matchList)) {
                 std::cout << preDivider;
-                const auto& matchList = hashFileListIter->second;
-                for (unsigned mIdx = 0; mIdx < matchList.size(); mIdx++) {
-                    const PathParts& pathParts = *matchList[mIdx];
-                    lstring fullPath = pathList[pathParts.pathIdx];
-                    fullPath += pathParts.name;
+                for (size_t mIdx = 0; mIdx < matchList.size(); mIdx++) {
+                    lstring fullPath = fileStore.path(matchList[mIdx]);
                     if (verbose) {
-                        std::cout << matchList.size() << " Hash " << hashFileListIter->first << " ";
+                        std::cout << matchList.size() << " Hash " << hashValue << " ";
                         print(fullPath, NULL);
                     } else {
                         if (mIdx != 0) std::cout << separator;
@@ -756,5 +1069,19 @@ bool DupFiles::end() {
             }
         }
     }
+
+    if (fileStore.size() != 0) {
+        const Arena& nameArena = fileStore.names.storage();
+        std::cerr << "  Indexed files=" << fileStore.size()
+            << " names=" << fileStore.names.size()
+            << " dirs=" << fileStore.dirs.size()
+            << " bytes/file=" << fileStore.bytes() / fileStore.size()
+            << std::endl;
+        std::cerr << "  Arena allocs=" << nameArena.allocations() + groupArena.allocations()
+            << " used=" << nameArena.used() + groupArena.used()
+            << " reserved=" << nameArena.reserved() + groupArena.reserved()
+            << std::endl;
+    }
+    groupArena.release();
     return true;
 }
@@ -51,11 +51,15 @@
 
 #include <vector>
 #include <regex>
+#include <string_view>
 #include "lstring.hpp"
+#include "filestore.hpp"
+#include "patterns.hpp"
+
+class PathBuf;
 
 // Helper types
 typedef std::vector<lstring> StringList;
-typedef std::vector<std::regex> PatternList;
 typedef unsigned int uint;
 typedef std::vector<unsigned> IntList;
 
@@ -65,6 +69,8 @@ public:
     // Runtime options
     PatternList includeFilePatList;
     PatternList excludeFilePatList;
+    PatternList includeDirPatList;  // subdirectory names, a rejected directory is never opened
+    PatternList excludeDirPatList;
     lstring DECRYPT_KEY;
 
     bool showFile = false;
@@ -78,12 +84,39 @@ public:
     bool showSame = true;
     bool showDiff = false;
     bool showMiss = false;
+    bool missFiles = false; // List each file of a directory missing from one tree
+    bool replicas = false;  // Compare 2 or more trees by relative path
+    bool dupDirs = false;   // Report duplicate directories as one group
+    bool moves = false;     // Pair files missing from each root by content
+    bool quick = false;     // Trust equal size and modify time, do not read content
+    unsigned quickSec = 0;  // -quick modify time granularity (seconds)
+    unsigned deepDays = 0;  // With -quick, hash a rotating 1/deepDays slice of files each day
+    bool merkle = false;    // Skip subtrees whose metadata digests match
+    lstring digestStore;    // Persisted content hashes reused across runs
+    lstring writeManifest;  // Manifest of the single tree to write, or to verify it against
+    lstring verifyManifest;
+    uint64_t minSize = 0;   // -minSize, -maxSize file length range
+    uint64_t maxSize = NO_SIZE;
+    time_t newerThan = 0;   // -newer, -older modify time range, 0 when not set
+    time_t olderThan = 0;
+    bool xdev = false;      // Stay on the file system of each starting directory
+    bool followLinks = false;   // Walk linked directories, each directory (dev, ino) once
+    StringList skipFsTypes = { // File system types never walked, -skipFs adds, -allFs clears
+        "proc", "sysfs", "cgroup", "cgroup2", "devpts", "devtmpfs", "debugfs", "tracefs",
+        "securityfs", "pstore", "bpf", "configfs", "fusectl", "mqueue", "binfmt_misc",
+        "autofs", "hugetlbfs", "devfs"
+    };
 
     unsigned logfile = 0;   // 0=default show both, else only show file 1 or 2
     unsigned sameCnt = 0;
     unsigned diffCnt = 0;
     unsigned missCnt = 0;
+    unsigned missDirCnt = 0;
+    unsigned moveCnt = 0;   // missing pairs matched by -moves
+    unsigned quickCnt = 0;  // same files trusted by -quick without reading
+    unsigned sameDirCnt = 0;  // identical subtrees pruned by -merkle
     unsigned skipCnt = 0; // exludue and include filters rejected file.
+    unsigned pruneCnt = 0;  // subdirectories rejected by -excludeDir / -includeDir
 
     lstring separator = "\n";
     lstring preDivider = "";
@@ -92,11 +125,16 @@ public:
     lstring preDup = "==";
     lstring preMissing = "-- ";
     lstring preDiff = "!= ";
+    lstring preMoved = "moved: ";
 
 private:
     lstring none;
     char code;
 
+protected:
+    lstring nameBuf;    // per file scratch, reused so adding a file does not allocate
+    lstring pathBuf;
+
 public:
     Command(char c) : code(c) {
     }
@@ -107,15 +145,75 @@ public:
 
     virtual size_t add(const lstring& file) = 0;
 
+    // Directory walker passes the id returned by addDir for the file's directory,
+    // parentId is NO_DIR for a scanned root.
+    static const unsigned NO_DIR = (unsigned)-1;
+    virtual unsigned addDir(unsigned /*parentId*/, const lstring& /*dirName*/) {
+        return 0;
+    }
+    // Root of a path list, taken as given, never stat'ed or resolved.
+    virtual unsigned addRoot(const lstring& rootPath) {
+        return addDir(NO_DIR, rootPath);
+    }
+    virtual size_t add(const lstring& file, unsigned /*dirId*/) {
+        return add(file);
+    }
+
+    // File of a directory listing, name points into the walker's buffer and is only
+    // valid during addBatch. Metadata is filled when needInfo() is true.
+    static const uint64_t NO_SIZE = (uint64_t)-1;
+    class Entry {
+    public:
+        unsigned dirId;
+        std::string_view name;
+        uint64_t size = NO_SIZE;    // NO_SIZE if not read
+        time_t   mtime = 0;
+        uint64_t dev = 0;
+        uint64_t ino = 0;           // 0 if not read or file system has no inode numbers
+        uint64_t hash = 0;          // content hash known from a manifest
+        HashKind hashKind = HASH_NONE;
+    };
+    virtual bool needInfo() const {
+        return hasInfoFilter();
+    }
+    // Files of one directory, dirPath is the directory's path and is restored on return.
+    virtual size_t addBatch(PathBuf& dirPath, const Entry* entries, size_t count);
+
     virtual bool end() {
         return true;
     }
 
-    bool validFile(const lstring& name);
+    bool validFile(std::string_view name);
+    bool isValidName(std::string_view name) const;  // validFile without counting, thread safe
+    bool validDir(std::string_view name);
+    bool hasInfoFilter() const {
+        return minSize != 0 || maxSize != NO_SIZE || newerThan != 0 || olderThan != 0;
+    }
+    bool validInfo(uint64_t size, time_t mtime);
+    bool isValidInfo(uint64_t size, time_t mtime) const;   // validInfo without counting, thread safe
+    bool isValidDirName(std::string_view name) const;   // validDir without counting, thread safe
+    bool hasMountFilter() const {
+#ifdef HAVE_WIN
+        return false;   // directory listing has no device id
+#else
+        return xdev || ! skipFsTypes.empty();
+#endif
+    }
+    bool validMount(const char* dirPath, uint64_t dev, uint64_t parentDev);
+    bool isValidMount(const char* dirPath, uint64_t dev, uint64_t parentDev) const;  // thread safe
 
     Command& share(const Command& other) {
         includeFilePatList = other.includeFilePatList;
         excludeFilePatList = other.excludeFilePatList;
+        includeDirPatList = other.includeDirPatList;
+        excludeDirPatList = other.excludeDirPatList;
+        minSize = other.minSize;
+        maxSize = other.maxSize;
+        newerThan = other.newerThan;
+        olderThan = other.olderThan;
+        xdev = other.xdev;
+        followLinks = other.followLinks;
+        skipFsTypes = other.skipFsTypes;
         DECRYPT_KEY = other.DECRYPT_KEY;
         showFile = other.showFile;
         verbose = other.verbose;
@@ -146,16 +244,34 @@ public:
 
     DupDecode() : Command('d') {}
     virtual size_t add(const lstring& file);
+    virtual size_t addBatch(PathBuf& dirPath, const Entry* entries, size_t count);
+    size_t addValid(const lstring& fullname, const lstring& name);
 };
 
 class DupFiles : public Command {
+    FileStore fileStore;
+    Arena groupArena;       // grouping scratch, released at end()
+    std::vector<uint32_t> dupDirGroup;  // by dirId, -dupDirs group reported holding it, NO_DIR if none
+    std::vector<uint32_t> dupDirTop;    // by dirId, top-most reported directory holding it
 public:
     DupFiles() : Command('f') {}
     virtual  bool begin(StringList& fileDirList);
     virtual size_t add(const lstring& file);
+    virtual unsigned addDir(unsigned parentId, const lstring& dirName);
+    virtual unsigned addRoot(const lstring& rootPath) {
+        return fileStore.addRoot(rootPath);
+    }
+    virtual size_t add(const lstring& file, unsigned dirId);
+    virtual bool needInfo() const {
+        return Command::needInfo() || (! justName && (! sameName || dupDirs));
+    }
+    virtual size_t addBatch(PathBuf& dirPath, const Entry* entries, size_t count);
     virtual bool end();
 
-    void printPaths(const IntList& pathListIdx, const std::string& name);
+    void printPaths(const IntList& dirIds, const char* name);
+    void findDupDirs();
+    bool dropDupDirFiles(std::vector<uint32_t>& recs) const;
+    HashKind groupHashKind(const std::vector<uint32_t>& order, size_t pos, size_t endPos) const;
 };
 
 class CompareAxxPair : public Command {
@@ -164,5 +280,7 @@ public:
     CompareAxxPair() : Command('c') {}
     virtual  bool begin(StringList& fileDirList);
     virtual size_t add(const lstring& file);
+    virtual size_t addBatch(PathBuf& dirPath, const Entry* entries, size_t count);
+    size_t addValid(const lstring& fullname, const lstring& name);
 };
 
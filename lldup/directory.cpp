@@ -145,6 +145,11 @@ bool Directory_files::is_directory() const {
     return (my_dir_hnd != INVALID_HANDLE_VALUE && isDir(my_dirent.dwFileAttributes));
 }
 
+//-------------------------------------------------------------------------------------------------
+bool Directory_files::is_link() const {
+    return (my_dir_hnd != INVALID_HANDLE_VALUE && (my_dirent.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0);
+}
+
 //-------------------------------------------------------------------------------------------------
 const char* Directory_files::name() const {
     return (my_dir_hnd != INVALID_HANDLE_VALUE) ?
@@ -157,10 +162,32 @@ const lstring& Directory_files::fullName(lstring& fname) const {
     return GetFullPath(fname);
 }
 
+//-------------------------------------------------------------------------------------------------
+// Metadata comes from the find data, no extra file system call.
+bool Directory_files::getInfo(struct stat& info) const {
+    if (my_dir_hnd == INVALID_HANDLE_VALUE)
+        return false;
+    const uint64_t EPOCH_DIFF = 116444736000000000ULL;  // 1601 to 1970 in 100ns units
+    uint64_t ftime = ((uint64_t)my_dirent.ftLastWriteTime.dwHighDateTime << 32) | my_dirent.ftLastWriteTime.dwLowDateTime;
+    memset(&info, 0, sizeof(info));
+    info.st_size = ((uint64_t)my_dirent.nFileSizeHigh << 32) | my_dirent.nFileSizeLow;
+    info.st_mtime = (time_t)((ftime - EPOCH_DIFF) / 10000000ULL);
+    info.st_mode = isDir(my_dirent.dwFileAttributes) ? _S_IFDIR : _S_IFREG;
+    return true;
+}
+
 #else
 
 #include <unistd.h>
 #include <stdlib.h>
+#if defined(__APPLE__)
+#include <sys/param.h>
+#include <sys/mount.h>
+#else
+#include <sys/vfs.h>
+#include <sys/sysmacros.h>
+#include <fstream>
+#endif
 
 const lstring Directory_files::SLASH = "/";
 const char Directory_files::SLASH_CHAR = '/';
@@ -209,6 +236,11 @@ bool Directory_files::is_directory() const {
     return my_pDirEnt->d_type == DT_DIR;
 }
 
+//-------------------------------------------------------------------------------------------------
+bool Directory_files::is_link() const {
+    return my_pDirEnt->d_type == DT_LNK;
+}
+
 //-------------------------------------------------------------------------------------------------
 const char* Directory_files::name() const {
     return my_pDirEnt->d_name;
@@ -218,6 +250,12 @@ const char* Directory_files::name() const {
 const lstring& Directory_files::fullName(lstring& fname) const {
     return DirUtil::join(fname, my_baseDir, my_pDirEnt->d_name);
 }
+
+//-------------------------------------------------------------------------------------------------
+// Stat relative to the open directory, avoids resolving the full path again.
+bool Directory_files::getInfo(struct stat& info) const {
+    return fstatat(dirfd(my_pDir), my_pDirEnt->d_name, &info, 0) == 0;
+}
 #endif
 
 //-------------------------------------------------------------------------------------------------
@@ -354,6 +392,19 @@ size_t DirUtil::fileLength(const lstring& path) {
     return ( stat(path, &info) == 0 ) ? info.st_size : -1;
 }
 
+//-------------------------------------------------------------------------------------------------
+// [static] Return absolute path, same form Directory_files uses for its entries.
+lstring& DirUtil::fullPath(lstring& outPath, const lstring& inPath) {
+#ifdef HAVE_WIN
+    outPath = inPath;
+    GetFullPath(outPath);
+#else
+    char fullname[PATH_MAX];
+    outPath = (realpath(inPath.c_str(), fullname) != nullptr) ? fullname : inPath.c_str();
+#endif
+    return outPath;
+}
+
 //-------------------------------------------------------------------------------------------------
 bool DirUtil::fileExists(const char* path) {
 #ifdef HAVE_WIN
@@ -363,3 +414,73 @@ bool DirUtil::fileExists(const char* path) {
     return access(path, F_OK) == 0;
 #endif
 }
+
+//-------------------------------------------------------------------------------------------------
+// [static] Return file system type holding path, ex: "apfs", "proc", "tmpfs",
+// empty if unknown.
+lstring& DirUtil::fileSystemType(lstring& outType, const char* path) {
+    outType.clear();
+#if defined(__APPLE__)
+    struct statfs info;
+    if (statfs(path, &info) == 0)
+        outType = info.f_fstypename;
+#elif defined(__linux__)
+    // Type as mounted, from the mountinfo line of the path's device, ex: devtmpfs
+    // which statfs reports as tmpfs. Lines are: id parent major:minor root mount ... - type source
+    struct stat pathInfo;
+    if (stat(path, &pathInfo) == 0) {
+        char devId[32];
+        snprintf(devId, sizeof(devId), "%u:%u", major(pathInfo.st_dev), minor(pathInfo.st_dev));
+        std::ifstream mountInfo("/proc/self/mountinfo");
+        std::string line;
+        while (std::getline(mountInfo, line)) {
+            size_t devPos = line.find(' ', line.find(' ') + 1) + 1;
+            size_t typePos = line.find(" - ");
+            if (devPos == 0 || typePos == std::string::npos
+                || line.compare(devPos, strlen(devId) + 1, std::string(devId) + " ") != 0)
+                continue;
+            typePos += 3;
+            outType = line.substr(typePos, line.find(' ', typePos) - typePos);
+            return outType;
+        }
+    }
+
+    // No /proc, magic numbers from linux/magic.h, only the types worth naming.
+    static const struct { unsigned long magic; const char* name; } FS_TYPES[] = {
+        { 0x9fa0,     "proc" },
+        { 0x62656572, "sysfs" },
+        { 0x27e0eb,   "cgroup" },
+        { 0x63677270, "cgroup2" },
+        { 0x1cd1,     "devpts" },
+        { 0x64626720, "debugfs" },
+        { 0x74726163, "tracefs" },
+        { 0x73636673, "securityfs" },
+        { 0x6165676c, "pstore" },
+        { 0xcafe4a11, "bpf" },
+        { 0x62656570, "configfs" },
+        { 0x65735543, "fusectl" },
+        { 0x19800202, "mqueue" },
+        { 0x42494e4d, "binfmt_misc" },
+        { 0x0187,     "autofs" },
+        { 0x958458f6, "hugetlbfs" },
+        { 0x01021994, "tmpfs" },
+        { 0x6969,     "nfs" },
+        { 0xff534d42, "cifs" },
+        { 0x65735546, "fuse" },
+        { 0xef53,     "ext4" },
+        { 0x58465342, "xfs" },
+        { 0x9123683e, "btrfs" },
+        { 0x794c7630, "overlay" },
+    };
+    struct statfs info;
+    if (statfs(path, &info) == 0) {
+        for (const auto& fsType : FS_TYPES) {
+            if ((unsigned long)info.f_type == fsType.magic) {
+                outType = fsType.name;
+                break;
+            }
+        }
+    }
+#endif
+    return outType;
+}
@@ -44,6 +44,7 @@
 #pragma once
 
 #include "ll_stdhdr.hpp"
+#include <string_view>
 
 
 #ifdef HAVE_WIN
@@ -81,6 +82,9 @@
     #if !defined(S_ISREG) && defined(S_IFMT) && defined(S_IFREG)
         #define S_ISREG(m) (((m) & S_IFMT) == S_IFREG)
     #endif
+    #if !defined(S_ISDIR) && defined(S_IFMT) && defined(S_IFDIR)
+        #define S_ISDIR(m) (((m) & S_IFMT) == S_IFDIR)
+    #endif
 #else
     const char SLASH_CHAR('/');
     #include <sys/fcntl.h>
@@ -103,12 +107,19 @@ public:
     // Return true if current file is a directory
     bool   is_directory() const;
 
+    // Return true if current entry is a symbolic link (reparse point on windows),
+    // getInfo() describes its target.
+    bool   is_link() const;
+
     // Return file/directory entry name
     const char* name() const;
 
     // Return directory path and entry name.
     const lstring& fullName(lstring& fname) const;
 
+    // Return size, modify time and mode of current entry, false if not available.
+    bool   getInfo(struct stat& info) const;
+
     // Close current directory
     void close();
 
@@ -144,6 +155,8 @@ namespace DirUtil {
  bool deleteFile(bool dryRun, const char* inPath);
  bool setPermission(const char* inPath, unsigned permission, bool setAllParts = false);
  size_t fileLength(const lstring& path);
+ lstring& fullPath(lstring& outPath, const lstring& inPath);
+ lstring& fileSystemType(lstring& outType, const char* path);
  bool fileExists(const char* path);bool makeWriteableFile(const char* filePath, struct stat* info);
 inline bool isWriteableFile(const struct stat& info) {
 #ifdef HAVE_WIN
@@ -157,11 +170,73 @@ inline bool isWriteableFile(const struct stat& info) {
  inline unsigned int minU(unsigned int A, unsigned int B) { return (A<=B) ? A:B; }
 
  // Utility to join directory and name and replace any double slashes with a single slash.
+ // Built in outPath, no allocation once outPath has the capacity.
 inline const lstring& join(lstring& outPath, const char* inDir, const char* inName, unsigned int pathOff = 0) {
      // return realpath(fname.c_str(), my_fullname) or   GetFullPath(fname);
-     return ReplaceAll(( outPath = lstring(inDir+pathOff) + Directory_files::SLASH + inName ), Directory_files::SLASH2, Directory_files::SLASH);
+     outPath.assign(inDir + pathOff);
+     outPath += Directory_files::SLASH_CHAR;
+     outPath += inName;
+     if (outPath.find(Directory_files::SLASH2) != lstring::npos)
+         ReplaceAll(outPath, Directory_files::SLASH2, Directory_files::SLASH);
+     return outPath;
  }
 inline const lstring& join(lstring& outPath, lstring& inDir, const char* inName) {
-     return ReplaceAll(( outPath = inDir + Directory_files::SLASH + inName ), Directory_files::SLASH2, Directory_files::SLASH);
+     return join(outPath, inDir.c_str(), inName);
  }
-}
\ No newline at end of file
+}
+
+// Reusable path builder, names are appended and truncated in place so walking a
+// directory makes no allocation per entry. Separators are normalized once by setRoot.
+//
+//      PathBuf path(rootDir);
+//      size_t mark = path.push(name);
+//      ... use path ...
+//      path.truncate(mark);
+class PathBuf {
+public:
+    PathBuf() {}
+    explicit PathBuf(const char* root) {
+        setRoot(root);
+    }
+
+    // Set root, convert '/' to the native separator and collapse doubled separators,
+    // a leading \\ (UNC) is kept on windows.
+    PathBuf& setRoot(const char* root) {
+        path.clear();
+        for (const char* ptr = root; *ptr != '\0'; ptr++) {
+            char chr = (*ptr == '/') ? Directory_files::SLASH_CHAR : *ptr;
+            bool doubled = (chr == Directory_files::SLASH_CHAR && ! path.empty() && path.back() == chr);
+            if (! doubled || (path.length() == 1 && chr == '\\'))
+                path += chr;
+        }
+        return *this;
+    }
+
+    // Append separator and name, return previous length to pass to truncate.
+    size_t push(const char* name) {
+        size_t mark = path.length();
+        if (! path.empty() && path.back() != Directory_files::SLASH_CHAR)
+            path += Directory_files::SLASH_CHAR;
+        path += name;
+        return mark;
+    }
+    void truncate(size_t len) {
+        path.resize(len);
+    }
+
+    size_t length() const {
+        return path.length();
+    }
+    const lstring& str() const {
+        return path;
+    }
+    std::string_view view() const {
+        return std::string_view(path.data(), path.length());
+    }
+    operator const char*() const {
+        return path.c_str();
+    }
+
+private:
+    lstring path;
+};
\ No newline at end of file
@@ -32,8 +32,13 @@
 
 #include "dupscan.hpp"
 #include "directory.hpp"
+#include "signals.hpp"
+#include "manifest.hpp"
 
 #include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <limits.h>
 
 #include "md5.hpp"
 #include "xxhash64.hpp"
@@ -51,109 +56,878 @@ lstring& toString(lstring& buf, TT value) {
 }
 
 // ---------------------------------------------------------------------------
-static size_t fileLength(const lstring& path) {
-    struct stat info;
-    return (stat(path, &info) == 0) ? info.st_size : -1;
+// Walk all trees depth-first starting at their roots.
+unsigned DupScan::findDuplicates(const StringList& baseDirList) {
+    if (baseDirList.size() > 2) {
+        for (size_t root = 0; root < baseDirList.size(); root++)
+            std::cerr << "  Replica " << root + 1 << " " << baseDirList[root] << std::endl;
+    }
+    if (! command.digestStore.empty())
+        hashStore.load(command.digestStore);
+    digestMemo.resize(baseDirList.size());
+    memoLevels.assign(baseDirList.size(), UINT_MAX);
+    ignores.resize(baseDirList.size());
+    startWorkers(baseDirList);
+    unsigned maxLevel = scanDir(0, baseDirList, "");
+    if (command.moves && baseDirList.size() == 2)
+        findMoves();
+    workers.clear();
+    rootWorker.clear();
+    digestMemo.clear();
+    memoLevels.clear();
+    ignores.clear();
+    if (! command.digestStore.empty()) {
+        hashStore.save(command.digestStore);
+        const Arena& storeArena = hashStore.storage();
+        std::cerr << "  DigestStore paths=" << hashStore.size()
+            << " arena allocs=" << storeArena.allocations()
+            << " used=" << storeArena.used()
+            << " reserved=" << storeArena.reserved()
+            << std::endl;
+    }
+    return maxLevel;
 }
 
 // ---------------------------------------------------------------------------
-bool DupScan::findDuplicates(unsigned level, const StringList& baseDirList, StringSet& subDirList) const {
-    scanFiles(level, baseDirList, subDirList);
+// Walk rootDir once, every file is hashed (or taken from -digestStore).
+size_t DupScan::writeManifest(const lstring& rootDir, const lstring& manifestPath) {
+    TreeManifest manifest;
+    if (! manifest.create(manifestPath)) {
+        std::cerr << "Unable to create " << manifestPath << std::endl;
+        return 0;
+    }
+    if (! command.digestStore.empty())
+        hashStore.load(command.digestStore);
 
-    StringSet outDirList;
-    getDirs(level, baseDirList, subDirList, outDirList);
-    subDirList.swap(outDirList);
+    IgnoreStack ignore;
+    PathBuf dirPath(rootDir);
+    std::string relPath;
+    size_t fileCnt = 0;
+    manifestDir(ignore, dirPath, relPath, manifest, nullptr, fileCnt);
+    if (! manifest.close())
+        std::cerr << "Error writing " << manifestPath << std::endl;
 
-    return subDirList.size() > 0;
+    if (! command.digestStore.empty())
+        hashStore.save(command.digestStore);
+    return fileCnt;
 }
 
 // ---------------------------------------------------------------------------
-void DupScan::scanFiles(unsigned level, const StringList& baseDirList, const StringSet& nextDirList) const {
-    StringSet files;
-    getFiles(level, baseDirList, nextDirList, files);
-    compareFiles(level, baseDirList, files);
+// Walk rootDir matching each file to its manifest record by relative path, records
+// no file matched are reported missing once the walk ends.
+size_t DupScan::verifyManifest(const lstring& rootDir, const lstring& manifestPath) {
+    TreeManifest manifest;
+    if (! manifest.load(manifestPath)) {
+        std::cerr << "Unable to read manifest " << manifestPath << std::endl;
+        return 0;
+    }
+    if (! command.digestStore.empty())
+        hashStore.load(command.digestStore);
+
+    IgnoreStack ignore;
+    PathBuf dirPath(rootDir);
+    std::string relPath;
+    size_t fileCnt = 0;
+    manifestDir(ignore, dirPath, relPath, manifest, &manifestPath, fileCnt);
+
+    // A record no live file matched is missing unless the walk left its path out,
+    // by a filter, .lldupignore rule or mount, while it is still on disk.
+    lstring label, livePath;
+    std::unordered_map<std::string_view, bool> prunedDirs;      // not walked but on disk
+    for (const ManifestRecord& record : manifest.records) {
+        if (record.seen || Signals::aborted)
+            continue;
+        size_t slash = record.path.rfind('/');
+        std::string_view name = record.path.substr(slash == std::string_view::npos ? 0 : slash + 1);
+        std::string_view dir = record.path.substr(0, record.path.length() - name.length());
+        if (! command.isValidName(name)
+            || (record.size != FileStore::NO_SIZE && ! command.isValidInfo(record.size, record.mtime)))
+            continue;   // filtered out of the live walk too
+        bool validDirs = true;
+        for (size_t pos = 0, end; validDirs && (end = dir.find('/', pos)) != std::string_view::npos; pos = end + 1)
+            validDirs = command.isValidDirName(dir.substr(pos, end - pos));
+        if (! validDirs) {
+            command.pruneCnt++;
+            continue;
+        }
+        if (walkedDirs.count(std::string(dir)) == 0) {
+            auto pruned = prunedDirs.find(dir);
+            if (pruned == prunedDirs.end())
+                pruned = prunedDirs.emplace(dir, DirUtil::fileExists(DirUtil::join(livePath, rootDir.c_str(), std::string(dir).c_str()))).first;
+            if (pruned->second) {
+                command.pruneCnt++;
+                continue;
+            }
+        } else if (DirUtil::fileExists(DirUtil::join(livePath, rootDir.c_str(), std::string(record.path).c_str()))) {
+            command.skipCnt++;  // ignored or not a regular file
+            continue;
+        }
+        label = manifestPath + ":";
+        label.append(record.path);
+        showMissing(false, "", true, label);
+    }
+    walkedDirs.clear();
+
+    if (! command.digestStore.empty())
+        hashStore.save(command.digestStore);
+    return fileCnt;
 }
 
 // ---------------------------------------------------------------------------
-void DupScan::getFiles(unsigned level, const StringList& baseDirList, const StringSet& nextDirList, StringSet& outFiles) const {
-    lstring joinBuf;
-    for (const lstring& nextDir : nextDirList) {
-        for (const lstring& baseDir : baseDirList) {
-            Directory_files directory(DirUtil::join(joinBuf, baseDir, nextDir));
-
-            while (directory.more()) {
-                if (! directory.is_directory()) {
-                    lstring name(directory.name());
-                    if (command.validFile(name)) {
-                        outFiles.insert(DirUtil::join(joinBuf, nextDir, name));
+// Write (verifyPath null) or verify the files of dirPath, relPath is dirPath below
+// the root with '/' separators so manifests move between platforms.
+void DupScan::manifestDir(IgnoreStack& ignore, PathBuf& dirPath, std::string& relPath,
+        TreeManifest& manifest, const lstring* verifyPath, size_t& fileCnt) {
+    ScanList entries;
+    getEntries(ignore, dirPath.str(), entries);
+    if (verifyPath != nullptr)
+        walkedDirs.insert(relPath);
+    lstring label;
+    for (const ScanEntry& entry : entries) {
+        if (Signals::aborted)
+            break;
+        size_t mark = dirPath.push(entry.name);
+        size_t relMark = relPath.length();
+        relPath += entry.name;
+        if (entry.isDir) {
+            if (command.isValidDirName(entry.name)) {
+                relPath += '/';
+                ignore.push(entry.name);
+                manifestDir(ignore, dirPath, relPath, manifest, verifyPath, fileCnt);
+                ignore.pop();
+            }
+        } else if (command.isValidName(entry.name) && command.isValidInfo(entry.size, entry.mtime)) {
+            const lstring& filePath = dirPath.str();
+            fileCnt++;
+            if (verifyPath == nullptr) {
+                manifest.write(relPath, entry.size, entry.mtime, fileHash(filePath, entry.size, entry.mtime));
+            } else {
+                label = *verifyPath + ":" + relPath;
+                ManifestRecord* record = manifest.find(relPath);
+                if (record == nullptr) {
+                    showMissing(true, filePath, false, label);
+                } else {
+                    record->seen = true;
+                    bool knownTime = record->size != FileStore::NO_SIZE && record->mtime != 0;
+                    if (record->size != FileStore::NO_SIZE && record->size != entry.size) {
+                        showDifferent(filePath, label);
+                    } else if (command.justName) {
+                        showDuplicate(filePath, label);
+                    } else if (command.quick && knownTime
+                            && std::abs((long long)(entry.mtime - record->mtime)) <= (long long)command.quickSec
+                            && ! inDeepSlice(lstring(relPath))) {
+                        command.quickCnt++;
+                        showDuplicate(filePath, label);
+                    } else if (fileHash(filePath, entry.size, entry.mtime) == record->hash) {
+                        showDuplicate(filePath, label);
+                    } else {
+                        showDifferent(filePath, label);
                     }
                 }
             }
         }
+        relPath.resize(relMark);
+        dirPath.truncate(mark);
     }
 }
 
 // ---------------------------------------------------------------------------
-void DupScan::getDirs(unsigned level, const StringList& baseDirList, const StringSet& nextDirList, StringSet& outDirList) const {
-    lstring joinBuf;
-    for (const lstring& nextDir : nextDirList) {
-        for (const lstring& baseDir : baseDirList) {
-            Directory_files directory(DirUtil::join(joinBuf, baseDir, nextDir));
-            lstring fullname;
-
-            while (directory.more()) {
-                if (directory.is_directory()) {
-                    outDirList.insert(DirUtil::join(joinBuf, nextDir, directory.name()));
+// Content hash of filePath, from -digestStore while size and time match.
+uint64_t DupScan::fileHash(const lstring& filePath, size_t size, time_t mtime) {
+    uint64_t hash;
+    if (hashStore.find(filePath, size, mtime, hash))
+        return hash;
+    hash = XXHash64::compute(filePath);
+    if (! command.digestStore.empty())
+        hashStore.put(filePath, size, mtime, hash);
+    return hash;
+}
+
+// ---------------------------------------------------------------------------
+// Assign one worker per device so both spindles stay busy, roots sharing a device
+// share a worker to avoid seek thrashing.
+void DupScan::startWorkers(const StringList& baseDirList) {
+    std::vector<dev_t> devices;
+    struct stat info;
+    for (const lstring& baseDir : baseDirList) {
+        dev_t device = (stat(baseDir, &info) == 0) ? info.st_dev : 0;
+        size_t idx = std::find(devices.begin(), devices.end(), device) - devices.begin();
+        if (idx == devices.size()) {
+            devices.push_back(device);
+            workers.emplace_back(new IoWorker());
+        }
+        rootWorker.push_back(workers[idx].get());
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Read subDir on every root, sort each listing and merge-join them by name. Every name
+// is classified per root as present or missing without any further file system calls.
+// Only this directory's listings are held per stack level.
+unsigned DupScan::scanDir(unsigned level, const StringList& baseDirList, const lstring& subDir) {
+    const size_t rootCnt = baseDirList.size();
+    StringList dirPaths(rootCnt);
+    for (size_t root = 0; root < rootCnt; root++)
+        DirUtil::join(dirPaths[root], baseDirList[root], subDir);
+
+    size_t sameFileCnt;
+    if (command.merkle && sameSubtree(dirPaths, level, sameFileCnt)) {
+        showSameDir(dirPaths, sameFileCnt);
+        return level;
+    }
+
+    std::vector<ScanList> lists(rootCnt);
+    std::vector<std::future<void>> done(rootCnt);
+    for (size_t root = 0; root < rootCnt; root++)
+        done[root] = rootWorker[root]->submit([&, root]() { getEntries(ignores[root], dirPaths[root], lists[root]); });
+    for (std::future<void>& rootDone : done)
+        rootDone.get();
+
+    StringList subDirs;
+    ReplicaTable files(rootCnt);
+    lstring dirPath;
+    std::vector<ScanList::const_iterator> iters(rootCnt);
+    std::vector<const ScanEntry*> row(rootCnt);
+    for (size_t root = 0; root < rootCnt; root++)
+        iters[root] = lists[root].cbegin();
+
+    for (;;) {
+        const lstring* name = nullptr;
+        for (size_t root = 0; root < rootCnt; root++) {
+            if (iters[root] != lists[root].cend() && (name == nullptr || iters[root]->name < *name))
+                name = &iters[root]->name;
+        }
+        if (name == nullptr)
+            break;
+
+        unsigned dirCnt = 0;
+        unsigned fileCnt = 0;
+        unsigned infoCnt = 0;
+        size_t dirRoot = 0;
+        for (size_t root = 0; root < rootCnt; root++) {
+            row[root] = nullptr;
+            if (iters[root] != lists[root].cend() && iters[root]->name == *name) {
+                const ScanEntry& entry = *iters[root]++;
+                if (entry.isDir) {
+                    dirCnt++;
+                    dirRoot = root;
+                } else {
+                    fileCnt++;
+                    row[root] = &entry;
+                    if (command.isValidInfo(entry.size, entry.mtime))
+                        infoCnt++;
                 }
             }
         }
+        if (dirCnt != 0 && ! command.validDir(*name)) {
+            dirCnt = 0;     // pruned, neither compared nor reported missing
+            for (size_t root = 0; root < rootCnt && command.merkle; root++)
+                forgetDigests(root, DirUtil::join(dirPath, dirPaths[root], *name));
+        }
+
+        if (dirCnt > 1 || (dirCnt == 1 && command.missFiles)) {
+            subDirs.push_back(*name);
+        } else if (dirCnt == 1) {
+            if (command.merkle)
+                forgetDigests(dirRoot, DirUtil::join(dirPath, dirPaths[dirRoot], *name));
+            // Report the whole one-sided subtree once, never descend into it.
+            size_t showRoot = (command.invert && rootCnt == 2) ? 1 - dirRoot : dirRoot;
+            ignores[showRoot].push(*name);
+            showMissingDir(DirUtil::join(dirPath, dirPaths[showRoot], *name), ignores[showRoot]);
+            ignores[showRoot].pop();
+            if (command.moves && rootCnt == 2) {
+                ignores[dirRoot].push(*name);
+                addMissDir(dirRoot, DirUtil::join(dirPath, dirPaths[dirRoot], *name));
+                ignores[dirRoot].pop();
+            }
+        }
+
+        // Keep the row if any root passes -minSize/-newer..., so a file that only
+        // changed on one side is compared, not reported missing.
+        if (fileCnt != 0 && command.validFile(*name)) {
+            if (infoCnt != 0)
+                files.add(*name, row);
+            else
+                command.skipCnt++;
+        }
     }
+
+    hashFiles(dirPaths, subDir, files);
+    if (Signals::aborted)
+        return level;   // cells left unhashed would compare equal
+    showFiles(dirPaths, subDir, files);
+
+    // Release listings before descending.
+    lists.clear();
+
+    unsigned maxLevel = level;
+    lstring joinBuf;
+    for (const lstring& dir : subDirs) {
+        if (Signals::aborted)
+            break;
+        for (IgnoreStack& ignore : ignores)
+            ignore.push(dir);
+        maxLevel = std::max(maxLevel, scanDir(level + 1, baseDirList, DirUtil::join(joinBuf, subDir, dir)));
+        for (IgnoreStack& ignore : ignores)
+            ignore.pop();
+    }
+    return maxLevel;
 }
 
 // ---------------------------------------------------------------------------
-void DupScan::compareFiles(unsigned level, const StringList& baseDirList, const StringSet& files) const {
-    lstring joinBuf1, joinBuf2;
+// Compute the Merkle digest of dirPath on one root. Digests of subdirectories are kept in
+// digestMemo so descending into a differing subtree does not recompute them. Past MAX_MEMO
+// the deepest levels are dropped, the walk reaches shallow directories first, and a dropped
+// subtree is digested again when the walk gets to it. Runs on the root's worker.
+DirDigest DupScan::getDigest(size_t root, const lstring& dirPath, unsigned level) {
+    DigestMap& memo = digestMemo[root];
+    if (memo.empty())
+        memoLevels[root] = UINT_MAX;
+    DigestMap::iterator memoIter = memo.find(dirPath);
+    if (memoIter != memo.end()) {
+        DirDigest dirDigest = memoIter->second;
+        memo.erase(memoIter);
+        return dirDigest;
+    }
 
-    for (const lstring& file : files) {
-        StringList::const_iterator dirIter = baseDirList.begin();
-        size_t fileLen1 = fileLength(DirUtil::join(joinBuf1, *dirIter++, file));
-        size_t fileLen2 = 0;
-        bool matchingLen = true;
-        while (dirIter != baseDirList.end()) {
-            fileLen2 = fileLength(DirUtil::join(joinBuf2, *dirIter++, file));
-            if (command.justName) {
-                if (fileLen1 == fileLen2)
-                    showDuplicate(joinBuf1, joinBuf2);
-                else if (fileLen1 != -1 && fileLen2 != -1)
-                    showDifferent(joinBuf1, joinBuf2);
-                else
-                    showMissing((fileLen1 != -1), joinBuf1, (fileLen2 != -1), joinBuf2);
-            } else {
-                if (fileLen1 != fileLen2) {
-                    matchingLen = false;  // currently only two items in baseDirList, so no need to exit early
-                }
+    DirDigest dirDigest;
+    dirDigest.level = level;
+    if (! DirUtil::fileExists(dirPath))
+        return dirDigest;
+    dirDigest.exists = true;
+
+    IgnoreStack& ignore = ignores[root];
+    ScanList entries;
+    getEntries(ignore, dirPath, entries);
+
+    XXHash64 hasher(0);
+    PathBuf childPath(dirPath);
+    uint64_t hash;
+    for (const ScanEntry& entry : entries) {
+        if (Signals::aborted)
+            break;
+        if (entry.isDir && ! command.isValidDirName(entry.name))
+            continue;   // pruned
+        size_t mark = childPath.push(entry.name);
+        if (entry.isDir) {
+            ignore.push(entry.name);
+            DirDigest childDigest = getDigest(root, childPath.str(), level + 1);
+            ignore.pop();
+            if (level + 1 <= memoLevels[root]) {
+                memo[childPath.str()] = childDigest;
+                if (memo.size() > MAX_MEMO)
+                    trimDigests(root);
             }
+            hasher.add("/", 1);
+            hasher.add(entry.name.c_str(), entry.name.length() + 1);
+            hasher.add(&childDigest.digest, sizeof(childDigest.digest));
+            dirDigest.fileCnt += childDigest.fileCnt;
+        } else if (command.isValidName(entry.name) && command.isValidInfo(entry.size, entry.mtime)) {
+            hasher.add(entry.name.c_str(), entry.name.length() + 1);
+            hasher.add(&entry.size, sizeof(entry.size));
+            if (hashStore.find(childPath.str(), entry.size, entry.mtime, hash))
+                hasher.add(&hash, sizeof(hash));
+            else
+                hasher.add(&entry.mtime, sizeof(entry.mtime));
+            dirDigest.fileCnt++;
         }
+        childPath.truncate(mark);
+    }
+    dirDigest.digest = hasher.hash();
+    return dirDigest;
+}
 
-        if (command.justName)
+// ---------------------------------------------------------------------------
+// Return true if the subtree digests match on every root. Like -quick this trusts
+// names, sizes and modify times (or stored content hashes) without reading files.
+bool DupScan::sameSubtree(const StringList& dirPaths, unsigned level, size_t& outFileCnt) {
+    const size_t rootCnt = dirPaths.size();
+    std::vector<DirDigest> digests(rootCnt);
+    std::vector<std::future<void>> done(rootCnt);
+    for (size_t root = 0; root < rootCnt; root++)
+        done[root] = rootWorker[root]->submit([&, root]() { digests[root] = getDigest(root, dirPaths[root], level); });
+    for (std::future<void>& rootDone : done)
+        rootDone.get();
+
+    bool same = true;
+    for (size_t root = 0; root < rootCnt; root++)
+        same &= digests[root].exists && digests[root].digest == digests[0].digest;
+    outFileCnt = digests[0].fileCnt;
+
+    if (same) {
+        // Subtree is skipped, drop the digests memorized below it.
+        for (size_t root = 0; root < rootCnt; root++)
+            forgetDigests(root, dirPaths[root]);
+    }
+    return same;
+}
+
+// ---------------------------------------------------------------------------
+// Drop the deepest level of memorized digests until at most MAX_MEMO remain, deeper
+// digests are no longer memorized.
+void DupScan::trimDigests(size_t root) {
+    DigestMap& memo = digestMemo[root];
+    while (memo.size() > MAX_MEMO) {
+        unsigned deepest = 0;
+        for (const auto& entry : memo)
+            deepest = std::max(deepest, entry.second.level);
+        for (DigestMap::iterator memoIter = memo.begin(); memoIter != memo.end(); ) {
+            if (memoIter->second.level == deepest)
+                memoIter = memo.erase(memoIter);
+            else
+                ++memoIter;
+        }
+        memoLevels[root] = (deepest == 0) ? 0 : deepest - 1;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Drop the memorized digests of dirPath and below, the walk will not descend into it.
+void DupScan::forgetDigests(size_t root, const lstring& dirPath) {
+    DigestMap& memo = digestMemo[root];
+    if (memo.empty())
+        return;
+    memo.erase(dirPath);
+    lstring prefix = dirPath;
+    if (prefix.empty() || prefix.back() != Directory_files::SLASH_CHAR)
+        prefix += Directory_files::SLASH;
+    DigestMap::iterator memoIter = memo.lower_bound(prefix);
+    while (memoIter != memo.end() && memoIter->first.compare(0, prefix.length(), prefix) == 0)
+        memoIter = memo.erase(memoIter);
+}
+
+// ---------------------------------------------------------------------------
+// Return true if target, the directory a link in dirPath leads to, is dirPath or one of
+// the directories on its path, compared by (device, inode). Parents are stat'ed through
+// the links already followed, so a cycle through several links is caught too.
+static bool isLinkCycle(const lstring& dirPath, const struct stat& target) {
+    lstring path = dirPath;
+    if (path.empty() || path[0] != SLASH_CHAR) {
+        lstring cwd;
+        DirUtil::join(path, DirUtil::fullPath(cwd, ".").c_str(), dirPath);
+    }
+    struct stat info;
+    for (;;) {
+        while (path.length() > 1 && path.back() == SLASH_CHAR)
+            path.pop_back();
+        if (stat(path, &info) == 0 && info.st_dev == target.st_dev && info.st_ino == target.st_ino)
+            return true;
+        size_t slash = path.rfind(SLASH_CHAR);
+        if (slash == lstring::npos || path.length() == 1)
+            return false;
+        path.resize(slash == 0 ? 1 : slash);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Return sorted listing of dirPath, size and modify time come from the listing itself.
+// ignore is positioned at dirPath, names its rules ignore are left out, as are
+// mount points rejected by -xdev or -skipFs. Linked directories are listed only with
+// -followLinks and never when they lead to a directory already on dirPath's path.
+void DupScan::getEntries(IgnoreStack& ignore, const lstring& dirPath, ScanList& outEntries) const {
+    if (! DirUtil::fileExists(dirPath))
+        return;   // Directory_files would fall back to the parent directory.
+
+    struct stat info;
+    bool filterMount = command.hasMountFilter() && stat(dirPath, &info) == 0;
+    uint64_t dirDev = filterMount ? (uint64_t)info.st_dev : 0;
+    lstring subPath;
+    Directory_files directory(dirPath);
+    bool hasIgnoreFile = false;
+    while (directory.more()) {
+        bool isDir = directory.is_directory();
+        if (! directory.getInfo(info)) {
+            info.st_size = 0;
+            info.st_mtime = 0;
+            info.st_dev = dirDev;
+        } else if (directory.is_link() && S_ISDIR(info.st_mode)) {
+            if (! command.followLinks || isLinkCycle(dirPath, info))
+                continue;
+            isDir = true;
+        }
+        if (filterMount && isDir
+            && ! command.isValidMount(DirUtil::join(subPath, dirPath.c_str(), directory.name()), info.st_dev, dirDev))
             continue;
+        outEntries.emplace_back(directory.name(), isDir, (size_t)info.st_size, info.st_mtime);
+        hasIgnoreFile |= ! outEntries.back().isDir && outEntries.back().name == IgnoreStack::FILE_NAME;
+    }
 
-        if (matchingLen) {
-            dirIter = baseDirList.begin();
-            DirUtil::join(joinBuf1, *dirIter++, file);
-            HashValue hash1 = XXHash64::compute(joinBuf1);  // hashValue = Md5::compute(joinBuf);
-            while (dirIter != baseDirList.end()) {
-                DirUtil::join(joinBuf2, *dirIter++, file);
-                HashValue hash2 = XXHash64::compute(joinBuf2); // hashValue = Md5::compute(joinBuf);
-                if (hash1 == hash2) {
-                    showDuplicate(joinBuf1, joinBuf2);
-                } else {
-                    showDifferent(joinBuf1, joinBuf2);
+    if (hasIgnoreFile)
+        ignore.load(dirPath);
+    if (! ignore.empty()) {
+        outEntries.erase(std::remove_if(outEntries.begin(), outEntries.end(),
+            [&](const ScanEntry& entry) { return ignore.ignored(entry.name, entry.isDir); }), outEntries.end());
+    }
+    std::sort(outEntries.begin(), outEntries.end());
+}
+
+// ---------------------------------------------------------------------------
+// Count files and bytes below dirPath, listing metadata only.
+void DupScan::treeSize(IgnoreStack& ignore, PathBuf& dirPath, size_t& fileCnt, size_t& byteCnt) const {
+    ScanList entries;
+    getEntries(ignore, dirPath.str(), entries);
+    for (const ScanEntry& entry : entries) {
+        if (Signals::aborted)
+            break;
+        if (entry.isDir) {
+            if (! command.isValidDirName(entry.name))
+                continue;   // pruned
+            size_t mark = dirPath.push(entry.name);
+            ignore.push(entry.name);
+            treeSize(ignore, dirPath, fileCnt, byteCnt);
+            ignore.pop();
+            dirPath.truncate(mark);
+        } else if (command.isValidInfo(entry.size, entry.mtime)) {
+            fileCnt++;
+            byteCnt += entry.size;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Return true if relPath falls in today's slice of the -deep rotation, so every file
+// gets a full content check once every deepDays runs (days).
+bool DupScan::inDeepSlice(const lstring& relPath) const {
+    if (command.deepDays == 0)
+        return false;
+    uint64_t day = (uint64_t)time(nullptr) / (24 * 60 * 60);
+    return XXHash64::hash(relPath.c_str(), relPath.length(), 0) % command.deepDays == day % command.deepDays;
+}
+
+// ---------------------------------------------------------------------------
+// Only files whose length matches the same name on another root are candidates, each
+// candidate is hashed once. Every root hashes its candidates on its own worker.
+// With -quick a same length group whose modify times agree is trusted without reading.
+void DupScan::hashFiles(const StringList& dirPaths, const lstring& subDir, ReplicaTable& files) {
+    const size_t rootCnt = files.rootCnt;
+    size_t hashCnt = 0;
+    PathBuf relPath(subDir.empty() ? Directory_files::SLASH : subDir);
+    if (! command.justName) {
+        std::vector<char> trusted(files.entries.size(), 0);    // member of a -quick group
+        for (size_t row = 0; row < files.rows(); row++) {
+            for (size_t root1 = 0; root1 < rootCnt; root1++) {
+                const ScanEntry* entry1 = files.entry(row, root1);
+                if (entry1 == nullptr || files.needHash[row * rootCnt + root1] || trusted[row * rootCnt + root1])
+                    continue;
+
+                // Group roots holding the same length as root1 (earlier roots already grouped).
+                unsigned groupCnt = 1;
+                bool sameTime = true;
+                for (size_t root2 = root1 + 1; root2 < rootCnt; root2++) {
+                    const ScanEntry* entry2 = files.entry(row, root2);
+                    if (entry2 != nullptr && entry2->size == entry1->size) {
+                        groupCnt++;
+                        sameTime &= std::abs((long long)(entry2->mtime - entry1->mtime)) <= (long long)command.quickSec;
+                    }
+                }
+                if (groupCnt < 2)
+                    continue;
+
+                if (command.quick && sameTime) {
+                    size_t mark = relPath.push(*files.names[row]);
+                    bool deep = inDeepSlice(relPath.str());
+                    relPath.truncate(mark);
+                    if (! deep) {
+                        command.quickCnt++;
+                        for (size_t root2 = root1; root2 < rootCnt; root2++) {
+                            const ScanEntry* entry2 = files.entry(row, root2);
+                            if (entry2 != nullptr && entry2->size == entry1->size)
+                                trusted[row * rootCnt + root2] = 1;
+                        }
+                        continue;   // hashes stay equal (0), reported as duplicate
+                    }
+                }
+                for (size_t root2 = root1; root2 < rootCnt; root2++) {
+                    const ScanEntry* entry2 = files.entry(row, root2);
+                    if (entry2 != nullptr && entry2->size == entry1->size) {
+                        files.needHash[row * rootCnt + root2] = 1;
+                        hashCnt++;
+                    }
                 }
             }
+        }
+    }
+    if (hashCnt == 0)
+        return;
+
+    // Stored hashes are only read here, new hashes are marked (needHash=2) and stored after the join.
+    std::vector<std::future<void>> done(rootCnt);
+    for (size_t root = 0; root < rootCnt; root++) {
+        done[root] = rootWorker[root]->submit([&, root]() {
+            PathBuf filePath(dirPaths[root]);
+            for (size_t row = 0; row < files.rows() && ! Signals::aborted; row++) {
+                size_t cell = row * rootCnt + root;
+                if (files.needHash[cell]) {
+                    const ScanEntry* entry = files.entries[cell];
+                    size_t mark = filePath.push(*files.names[row]);
+                    if (! hashStore.find(filePath.str(), entry->size, entry->mtime, files.hashes[cell])) {
+                        files.hashes[cell] = XXHash64::compute(filePath);  // hashValue = Md5::compute(joinBuf);
+                        files.needHash[cell] = 2;
+                    }
+                    filePath.truncate(mark);
+                }
+            }
+        });
+    }
+    for (std::future<void>& rootDone : done)
+        rootDone.get();
+
+    if (! command.digestStore.empty()) {
+        lstring filePath;
+        for (size_t cell = 0; cell < files.entries.size(); cell++) {
+            if (files.needHash[cell] == 2) {
+                const ScanEntry* entry = files.entries[cell];
+                DirUtil::join(filePath, dirPaths[cell % rootCnt], *files.names[cell / rootCnt]);
+                hashStore.put(filePath, entry->size, entry->mtime, files.hashes[cell]);
+            }
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Report each file of the directory in listing order.
+void DupScan::showFiles(const StringList& dirPaths, const lstring& subDir, const ReplicaTable& files) {
+    if (files.rootCnt != 2) {
+        PathBuf relPath(subDir.empty() ? Directory_files::SLASH : subDir);
+        for (size_t row = 0; row < files.rows(); row++) {
+            size_t mark = relPath.push(*files.names[row]);
+            showReplicas(relPath.str(), files, row);
+            relPath.truncate(mark);
+        }
+        return;
+    }
+
+    PathBuf pathBuf1(dirPaths[0]);
+    PathBuf pathBuf2(dirPaths[1]);
+    const size_t mark1 = pathBuf1.length();
+    const size_t mark2 = pathBuf2.length();
+    for (size_t row = 0; row < files.rows(); row++) {
+        const lstring& name = *files.names[row];
+        const ScanEntry* file1 = files.entry(row, 0);
+        const ScanEntry* file2 = files.entry(row, 1);
+        pathBuf1.truncate(mark1);
+        pathBuf2.truncate(mark2);
+        pathBuf1.push(name);
+        pathBuf2.push(name);
+        const lstring& filePath1 = pathBuf1.str();
+        const lstring& filePath2 = pathBuf2.str();
+        if (file1 != nullptr && file2 == nullptr && command.moves)
+            missList[0].emplace_back(filePath1, filePath2, file1->size, file1->mtime, false);
+        else if (file1 == nullptr && file2 != nullptr && command.moves)
+            missList[1].emplace_back(filePath2, filePath1, file2->size, file2->mtime, false);
+        else if (file1 == nullptr || file2 == nullptr)
+            showMissing(file1 != nullptr, filePath1, file2 != nullptr, filePath2);
+        else if (file1->size != file2->size)
+            showDifferent(filePath1, filePath2);
+        else if (command.justName || files.hash(row, 0) == files.hash(row, 1))
+            showDuplicate(filePath1, filePath2);
+        else
+            showDifferent(filePath1, filePath2);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Report one file across 3 or more roots as a replica matrix, one column per root:
+//    P = present and matches the majority content, D = different, M = missing
+void DupScan::showReplicas(const lstring& relPath, const ReplicaTable& files, size_t row) {
+    const size_t rootCnt = files.rootCnt;
+
+    // Reference is the content held by most roots, earliest root wins a tie.
+    size_t refRoot = rootCnt;
+    unsigned refCnt = 0;
+    for (size_t root1 = 0; root1 < rootCnt; root1++) {
+        const ScanEntry* entry1 = files.entry(row, root1);
+        if (entry1 == nullptr)
+            continue;
+        unsigned matchCnt = 0;
+        for (size_t root2 = 0; root2 < rootCnt; root2++) {
+            const ScanEntry* entry2 = files.entry(row, root2);
+            if (entry2 != nullptr && entry2->size == entry1->size && files.hash(row, root2) == files.hash(row, root1))
+                matchCnt++;
+        }
+        if (matchCnt > refCnt) {
+            refCnt = matchCnt;
+            refRoot = root1;
+        }
+    }
+
+    lstring matrix;
+    bool anyDiff = false;
+    bool anyMiss = false;
+    for (size_t root = 0; root < rootCnt; root++) {
+        const ScanEntry* entry = files.entry(row, root);
+        if (entry == nullptr) {
+            matrix += 'M';
+            anyMiss = true;
+        } else if (entry->size == files.entry(row, refRoot)->size && files.hash(row, root) == files.hash(row, refRoot)) {
+            matrix += 'P';
         } else {
-            showMissing((fileLen1 != -1), joinBuf1, (fileLen2 != -1), joinBuf2);
+            matrix += 'D';
+            anyDiff = true;
+        }
+    }
+
+    bool show;
+    const char* prefix;
+    if (anyDiff) {
+        command.diffCnt++;
+        show = command.showDiff;
+        prefix = command.preDiff;
+    } else if (anyMiss) {
+        command.missCnt++;
+        show = command.showMiss;
+        prefix = command.preMissing;
+    } else {
+        command.sameCnt++;
+        show = command.showSame;
+        prefix = command.preDup;
+    }
+    if (show)
+        std::cout << prefix << matrix << " " << relPath << command.separator;
+}
+
+// ---------------------------------------------------------------------------
+// Add the files below a directory missing from the other root as move candidates,
+// they are already covered by the directory's missing report.
+void DupScan::addMissDir(size_t root, const lstring& dirPath) {
+    IgnoreStack& ignore = ignores[root];
+    ScanList entries;
+    getEntries(ignore, dirPath, entries);
+    lstring fullname;
+    for (const ScanEntry& entry : entries) {
+        if (Signals::aborted)
+            break;
+        DirUtil::join(fullname, dirPath, entry.name);
+        if (entry.isDir) {
+            if (command.isValidDirName(entry.name)) {
+                ignore.push(entry.name);
+                addMissDir(root, fullname);
+                ignore.pop();
+            }
+        } else if (command.isValidName(entry.name) && command.isValidInfo(entry.size, entry.mtime)) {
+            missList[root].emplace_back(fullname, "", entry.size, entry.mtime, true);
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Pair files missing from one root with files missing from the other root by content.
+// Only sizes missing on both sides are hashed, so the cost follows what changed.
+// Unpaired files are reported as missing.
+void DupScan::findMoves() {
+    typedef std::map<size_t, std::vector<MissFile*>> SizeMap;
+    SizeMap bySize[2];
+    for (size_t root = 0; root < 2; root++) {
+        for (MissFile& missFile : missList[root]) {
+            if (missFile.size != 0)
+                bySize[root][missFile.size].push_back(&missFile);
+        }
+    }
+
+    std::vector<MissFile*> toHash[2];
+    for (const auto& sizeGroup : bySize[0]) {
+        SizeMap::const_iterator other = bySize[1].find(sizeGroup.first);
+        if (other != bySize[1].end()) {
+            toHash[0].insert(toHash[0].end(), sizeGroup.second.begin(), sizeGroup.second.end());
+            toHash[1].insert(toHash[1].end(), other->second.begin(), other->second.end());
+        }
+    }
+
+    std::vector<std::future<void>> done(2);
+    for (size_t root = 0; root < 2; root++) {
+        done[root] = rootWorker[root]->submit([&, root]() {
+            for (MissFile* missFile : toHash[root]) {
+                if (Signals::aborted)
+                    break;
+                if (! hashStore.find(missFile->path, missFile->size, missFile->mtime, missFile->hash))
+                    missFile->hash = XXHash64::compute(missFile->path);
+            }
+        });
+    }
+    for (std::future<void>& rootDone : done)
+        rootDone.get();
+
+    // Match by size and hash, prefer a candidate with the same file name.
+    std::map<std::pair<size_t, uint64_t>, std::vector<MissFile*>> byContent;
+    for (MissFile* missFile : toHash[1])
+        byContent[std::make_pair(missFile->size, missFile->hash)].push_back(missFile);
+
+    for (MissFile* missFile1 : toHash[0]) {
+        auto found = byContent.find(std::make_pair(missFile1->size, missFile1->hash));
+        if (found == byContent.end())
+            continue;
+        std::vector<MissFile*>& candidates = found->second;
+        size_t pick = 0;
+        const char* name1 = strrchr(missFile1->path, Directory_files::SLASH_CHAR);
+        for (size_t idx = 0; idx < candidates.size(); idx++) {
+            const char* name2 = strrchr(candidates[idx]->path, Directory_files::SLASH_CHAR);
+            if (name1 != nullptr && name2 != nullptr && strcmp(name1, name2) == 0) {
+                pick = idx;
+                break;
+            }
+        }
+        MissFile* missFile2 = candidates[pick];
+        candidates.erase(candidates.begin() + pick);
+        if (candidates.empty())
+            byContent.erase(found);
+
+        missFile1->moved = missFile2->moved = true;
+        showMoved(missFile1->path, missFile2->path);
+    }
+
+    for (size_t root = 0; root < 2; root++) {
+        for (const MissFile& missFile : missList[root]) {
+            if (missFile.moved || missFile.inMissDir)
+                continue;
+            if (root == 0)
+                showMissing(true, missFile.path, false, missFile.otherPath);
+            else
+                showMissing(false, missFile.otherPath, true, missFile.path);
+        }
+        missList[root].clear();
+    }
+}
+
+// ---------------------------------------------------------------------------
+IoWorker::IoWorker() {
+    thread = std::thread(&IoWorker::run, this);
+}
+
+// ---------------------------------------------------------------------------
+IoWorker::~IoWorker() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    ready.notify_one();
+    thread.join();
+}
+
+// ---------------------------------------------------------------------------
+std::future<void> IoWorker::submit(std::function<void()> task) {
+    std::packaged_task<void()> packagedTask(task);
+    std::future<void> result = packagedTask.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(packagedTask));
+    }
+    ready.notify_one();
+    return result;
+}
+
+// ---------------------------------------------------------------------------
+void IoWorker::run() {
+    for (;;) {
+        std::packaged_task<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [this]() { return stopping || ! tasks.empty(); });
+            if (tasks.empty())
+                return;
+            task = std::move(tasks.front());
+            tasks.pop_front();
         }
+        task();
     }
 }
 
@@ -194,3 +968,156 @@ void DupScan::showMissing(bool have1,  const lstring& filePath1, bool have2, con
             std::cout << filePath2 << command.postDivider;
     }
 }
+
+// ---------------------------------------------------------------------------
+// Directory exists in only one tree, report it as a single missing subtree.
+// With -verbose the subtree is walked (no hashing) to add its file count and bytes.
+void DupScan::showMissingDir(const lstring& dirPath, const IgnoreStack& ignore) const {
+    command.missDirCnt++;
+    if (command.showMiss) {
+        std::cout << command.preMissing << dirPath << Directory_files::SLASH;
+        if (command.verbose) {
+            size_t fileCnt = 0;
+            size_t byteCnt = 0;
+            PathBuf treePath(dirPath);
+            IgnoreStack treeIgnore = ignore;
+            treeSize(treeIgnore, treePath, fileCnt, byteCnt);
+            std::cout << " files=" << fileCnt << " bytes=" << byteCnt;
+        }
+        std::cout << command.separator;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Same content missing from each root under a different path, file was moved or renamed.
+void DupScan::showMoved(const lstring& filePath1, const lstring& filePath2) const {
+    command.moveCnt++;
+    if (command.showMiss) {
+        std::cout << command.preMoved;
+        if (command.invert)
+            std::cout << filePath2 << " -> " << filePath1;
+        else
+            std::cout << filePath1 << " -> " << filePath2;
+        std::cout << command.separator;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Subtree digests match on every root, report it once with its file count.
+void DupScan::showSameDir(const StringList& dirPaths, size_t fileCnt) const {
+    command.sameCnt += (unsigned)fileCnt;
+    command.sameDirCnt++;
+    if (command.showSame) {
+        std::cout << command.preDup;
+        for (size_t root = 0; root < dirPaths.size(); root++) {
+            if (root != 0)
+                std::cout << command.separator;
+            std::cout << dirPaths[root];
+        }
+        std::cout << " files=" << fileCnt << command.postDivider;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Load store written by a previous run, lines of: hash size mtime path
+// A path holding \ or a newline is escaped and its line starts with \.
+bool HashStore::load(const lstring& storePath) {
+    std::ifstream in(storePath);
+    std::string line;
+    std::string path;
+    while (std::getline(in, line)) {
+        bool escaped = ! line.empty() && line[0] == '\\';
+        char* endPtr;
+        Item item;
+        item.hash = strtoull(line.c_str() + (escaped ? 1 : 0), &endPtr, 16);
+        item.size = (size_t)strtoull(endPtr, &endPtr, 10);
+        item.mtime = (time_t)strtoll(endPtr, &endPtr, 10);
+        if (*endPtr != ' ')
+            continue;
+        const char* pathPtr = endPtr + 1;
+        size_t pathLen = line.c_str() + line.length() - pathPtr;
+        if (escaped) {
+            path.clear();
+            for (const char* chr = pathPtr; *chr != '\0'; chr++) {
+                if (*chr == '\\' && chr[1] != '\0') {
+                    chr++;
+                    path += (*chr == 'n') ? '\n' : *chr;
+                } else {
+                    path += *chr;
+                }
+            }
+            pathPtr = path.c_str();
+            pathLen = path.length();
+        }
+        insert(pathPtr, pathLen) = item;
+    }
+    return ! items.empty();
+}
+
+// ---------------------------------------------------------------------------
+// Write to a temporary file renamed over the store, so an interrupted save keeps the old store.
+bool HashStore::save(const lstring& storePath) const {
+    lstring tmpPath = storePath + ".tmp";
+    std::ofstream out(tmpPath);
+    for (const auto& entry : items) {
+        const Item& item = entry.second;
+        std::string_view path = entry.first;
+        bool escape = path.find_first_of("\\\n") != std::string_view::npos;
+        if (escape)
+            out << "\\";
+        out << std::hex << item.hash << std::dec << " " << item.size << " " << (long long)item.mtime << " ";
+        if (escape) {
+            for (char chr : path) {
+                if (chr == '\\')
+                    out << "\\\\";
+                else if (chr == '\n')
+                    out << "\\n";
+                else
+                    out << chr;
+            }
+        } else {
+            out << path;
+        }
+        out << "\n";
+    }
+    out.close();
+    if (! out.good()) {
+        std::cerr << "Failed to save " << storePath << std::endl;
+        remove(tmpPath);
+        return false;
+    }
+#ifdef HAVE_WIN
+    remove(storePath);    // rename does not replace on Windows
+#endif
+    if (rename(tmpPath, storePath) != 0) {
+        std::cerr << "Failed to save " << storePath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+bool HashStore::find(const lstring& filePath, size_t size, time_t mtime, uint64_t& outHash) const {
+    auto iter = items.find(std::string_view(filePath.c_str(), filePath.length()));
+    if (iter == items.end() || iter->second.size != size || iter->second.mtime != mtime)
+        return false;
+    outHash = iter->second.hash;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+void HashStore::put(const lstring& filePath, size_t size, time_t mtime, uint64_t hash) {
+    Item& item = insert(filePath.c_str(), filePath.length());
+    item.size = size;
+    item.mtime = mtime;
+    item.hash = hash;
+}
+
+// ---------------------------------------------------------------------------
+// Return item of filePath, a new path is copied into the arena.
+HashStore::Item& HashStore::insert(const char* filePath, size_t len) {
+    auto iter = items.find(std::string_view(filePath, len));
+    if (iter == items.end())
+        iter = items.emplace(std::string_view(arena.copy(filePath, len), len), Item()).first;
+    return iter->second;
+}
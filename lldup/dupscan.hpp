@@ -6,13 +6,15 @@
 // Usage::
 //
 //      The normal usage will be something like this:
-//         DupScan dupScan;
-//         StringSet nextDirList;
-//         nextDirList.insert("");
-//         unsigned level = 0;
-//         while (dupScan.findDuplicates(level, fileDirList, nextDirList, *commandPtr)) {
-//             level++;
-//         }
+//         DupScan dupScan(*commandPtr);
+//         unsigned levels = dupScan.findDuplicates(fileDirList);
+//
+//      A tree can also be checked against a manifest written earlier, only the live tree is read:
+//         dupScan.writeManifest(backupDir, "backup.lldupmf");
+//         dupScan.verifyManifest(backupDir, "backup.lldupmf");
+//
+//      Trees are walked depth-first, only the merged listing of the directories on the
+//      current path are held in memory and results are reported as each directory completes.
 //-------------------------------------------------------------------------------------------------
 //
 // Author: Dennis Lang - 2024
@@ -46,34 +48,215 @@
 
 #include "ll_stdhdr.hpp"
 #include "commands.hpp"
+#include "arena.hpp"
+#include "ignorerules.hpp"
 
 #include <set>
+#include <map>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <string_view>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <future>
+#include <functional>
+#include <condition_variable>
 typedef set<lstring> StringSet;
 
+// One directory entry with the metadata captured while listing it.
+class ScanEntry {
+public:
+    lstring name;
+    bool    isDir;
+    size_t  size;
+    time_t  mtime;
+
+    ScanEntry(const char* _name, bool _isDir, size_t _size, time_t _mtime) :
+        name(_name), isDir(_isDir), size(_size), mtime(_mtime) {}
+
+    bool operator<(const ScanEntry& other) const {
+        return name < other.name;
+    }
+};
+typedef std::vector<ScanEntry> ScanList;
+
+// Files of one directory matched by name across all roots, one row per name and one
+// column per root, stored flat so a directory costs a handful of allocations.
+class ReplicaTable {
+public:
+    const size_t rootCnt;
+    std::vector<const lstring*> names;
+    std::vector<const ScanEntry*> entries;  // [row * rootCnt + root], nullptr when missing
+    std::vector<uint64_t> hashes;           // [row * rootCnt + root], set when needHash
+    std::vector<char> needHash;             // [row * rootCnt + root]
+
+    ReplicaTable(size_t _rootCnt) : rootCnt(_rootCnt) {}
+
+    size_t rows() const {
+        return names.size();
+    }
+    void add(const lstring& name, const std::vector<const ScanEntry*>& row) {
+        names.push_back(&name);
+        entries.insert(entries.end(), row.begin(), row.end());
+        hashes.resize(entries.size(), 0);
+        needHash.resize(entries.size(), 0);
+    }
+    const ScanEntry* entry(size_t row, size_t root) const {
+        return entries[row * rootCnt + root];
+    }
+    uint64_t hash(size_t row, size_t root) const {
+        return hashes[row * rootCnt + root];
+    }
+};
+
+// Persisted content hashes keyed by full path, an entry is valid while the file's
+// size and modify time are unchanged. Paths and table nodes live in one arena.
+class HashStore {
+public:
+    HashStore() : items(ArenaAlloc<ItemPair>(arena)) {}
+
+    bool load(const lstring& storePath);
+    bool save(const lstring& storePath) const;
+
+    bool find(const lstring& filePath, size_t size, time_t mtime, uint64_t& outHash) const;
+    void put(const lstring& filePath, size_t size, time_t mtime, uint64_t hash);
+
+    size_t size() const {
+        return items.size();
+    }
+    const Arena& storage() const {
+        return arena;
+    }
+
+private:
+    class Item {
+    public:
+        size_t   size;
+        time_t   mtime;
+        uint64_t hash;
+    };
+    typedef std::pair<const std::string_view, Item> ItemPair;
+
+    Arena arena;    // declared before items, which allocate from it
+    std::unordered_map<std::string_view, Item, std::hash<std::string_view>, std::equal_to<std::string_view>,
+        ArenaAlloc<ItemPair>> items;
+
+    Item& insert(const char* filePath, size_t len);
+};
+
+// Merkle digest of a directory subtree built from child names, sizes and modify times
+// (or stored content hashes) plus the digests of its subdirectories.
+class DirDigest {
+public:
+    uint64_t digest = 0;
+    size_t   fileCnt = 0;
+    bool     exists = false;
+    unsigned level = 0;     // scanDir level, the deepest memorized digests are dropped first
+};
+typedef std::map<lstring, DirDigest> DigestMap;
+
+// File present on only one of two roots. With -moves it is kept until the walk ends so
+// it can be paired by content with a file missing from the other root.
+class MissFile {
+public:
+    lstring  path;          // full path on the root holding the file
+    lstring  otherPath;     // same relative path on the other root
+    size_t   size;
+    time_t   mtime;
+    bool     inMissDir;     // below a directory already reported missing
+    uint64_t hash = 0;
+    bool     moved = false;
+
+    MissFile(const lstring& _path, const lstring& _otherPath, size_t _size, time_t _mtime, bool _inMissDir) :
+        path(_path), otherPath(_otherPath), size(_size), mtime(_mtime), inMissDir(_inMissDir) {}
+};
+typedef std::vector<MissFile> MissList;
+
+class TreeManifest;
+
+// Single thread which runs file system requests for one device.
+class IoWorker {
+public:
+    IoWorker();
+    ~IoWorker();
+
+    // Queue task, caller waits on returned future.
+    std::future<void> submit(std::function<void()> task);
+
+private:
+    void run();
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<std::packaged_task<void()>> tasks;
+    bool stopping = false;
+};
+
 class DupScan {
 public:
+    static const size_t MAX_MEMO = 1 << 16;    // memorized digests per root
+
     Command& command;
 
     DupScan(Command& _command) : command(_command) { }
 
     // Find duplicate files by name, size and hash_value
-    //    Level used for diagnostics only.
-    //    baseDirList contains 2 root directories to compare files by name, size and content.
-    //    subDirList contains subdirectory paths to append to root, can be single emptry string.
-    //    subDirList is replace with new set of directories for each depth level scanned.
-    //    command - currently not used
+    //    baseDirList contains 2 or more root directories to compare files by name, size and content.
+    //    With 2 roots each file is reported as duplicate, different or missing, with more roots
+    //    a replica matrix is reported per file.
+    //    Roots on different devices are listed and hashed concurrently, one IoWorker per device.
     //
-    //    returns - false when no more directories available.
-    bool findDuplicates(unsigned level, const StringList& baseDirList, StringSet& subDirList) const;
+    //    returns - deepest directory level scanned.
+    unsigned findDuplicates(const StringList& baseDirList);
+
+    // Write relative path, size, modify time and XXH64 of each file below rootDir to
+    // manifestPath, text when it ends with .txt else binary. Returns files written.
+    size_t writeManifest(const lstring& rootDir, const lstring& manifestPath);
+
+    // Compare the files below rootDir to a manifest, reported as duplicate, different or
+    // missing like a two tree scan. -quick trusts equal size and modify time. Returns files checked.
+    size_t verifyManifest(const lstring& rootDir, const lstring& manifestPath);
 
 private:
-    void scanFiles(unsigned level, const StringList& baseDirList, const StringSet& nextDirList) const;
-    void getFiles(unsigned level, const StringList& baseDirList, const StringSet& nextDirList, set<lstring>& files) const;
-    void getDirs(unsigned level, const StringList& baseDirList, const StringSet& nextDirList, StringSet& outDirList) const;
-    void compareFiles(unsigned level, const StringList& baseDirList, const set<lstring>& files) const;
+    std::vector<std::unique_ptr<IoWorker>> workers;
+    std::vector<IoWorker*> rootWorker;  // worker serving each root in baseDirList
+
+    HashStore hashStore;
+    std::vector<DigestMap> digestMemo;  // per root, subdirectory digests computed ahead of the walk, at most MAX_MEMO
+    std::vector<unsigned> memoLevels;   // per root, deepest level still memorized
+    MissList missList[2];               // with -moves, files missing from the other root
+    std::vector<IgnoreStack> ignores;   // per root, .lldupignore rules of the directory being scanned
+    std::unordered_set<std::string> walkedDirs;     // -verifyManifest, relative directories walked
+
+    void startWorkers(const StringList& baseDirList);
+    DirDigest getDigest(size_t root, const lstring& dirPath, unsigned level);
+    bool sameSubtree(const StringList& dirPaths, unsigned level, size_t& outFileCnt);
+    void forgetDigests(size_t root, const lstring& dirPath);
+    void trimDigests(size_t root);
+
+    // Merge-join the sorted listings of subDir (relative to each root), compare the files
+    // then descend into its subdirectories.
+    unsigned scanDir(unsigned level, const StringList& baseDirList, const lstring& subDir);
+    void getEntries(IgnoreStack& ignore, const lstring& dirPath, ScanList& outEntries) const;
+    void treeSize(IgnoreStack& ignore, PathBuf& dirPath, size_t& fileCnt, size_t& byteCnt) const;
+    bool inDeepSlice(const lstring& relPath) const;
+    void hashFiles(const StringList& dirPaths, const lstring& subDir, ReplicaTable& files);
+    void showFiles(const StringList& dirPaths, const lstring& subDir, const ReplicaTable& files);
+    void showReplicas(const lstring& relPath, const ReplicaTable& files, size_t row);
+    void addMissDir(size_t root, const lstring& dirPath);
+    void findMoves();
+    void manifestDir(IgnoreStack& ignore, PathBuf& dirPath, std::string& relPath,
+        TreeManifest& manifest, const lstring* verifyPath, size_t& fileCnt);
+    uint64_t fileHash(const lstring& filePath, size_t size, time_t mtime);
 
     void showDuplicate(const lstring& filePath1, const lstring& filePath2) const;
     void showDifferent(const lstring& filePath1, const lstring& filePath2) const;
     void showMissing(bool have1, const lstring & filePath1, bool have2, const lstring& filePath2) const;
+    void showMissingDir(const lstring& dirPath, const IgnoreStack& ignore) const;
+    void showMoved(const lstring& filePath1, const lstring& filePath2) const;
+    void showSameDir(const StringList& dirPaths, size_t fileCnt) const;
 };
-
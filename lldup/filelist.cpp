@@ -0,0 +1,141 @@
+//-------------------------------------------------------------------------------------------------
+//
+// File: filelist.cpp   Author: Dennis Lang  Desc: Read file path lists on a reader thread.
+//
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2024
+// https://landenlabs.com
+//
+// This file is part of lldup project.
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "filelist.hpp"
+
+#ifdef HAVE_WIN
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+// ---------------------------------------------------------------------------
+FileListReader::FileListReader(const lstring& listPath, char _delim) : delim(_delim) {
+    if (listPath == "-") {
+        in = stdin;
+#ifdef HAVE_WIN
+        _setmode(_fileno(stdin), _O_BINARY);   // keep NUL and CR as read
+#endif
+    } else {
+        in = fopen(listPath.c_str(), "rb");
+        closeIn = true;
+    }
+    if (in != nullptr)
+        thread = std::thread(&FileListReader::run, this);
+    else
+        done = true;
+}
+
+// ---------------------------------------------------------------------------
+FileListReader::~FileListReader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    space.notify_all();
+    if (thread.joinable())
+        thread.join();
+    if (closeIn && in != nullptr)
+        fclose(in);
+}
+
+// ---------------------------------------------------------------------------
+bool FileListReader::next(Block& outBlock) {
+    std::unique_lock<std::mutex> lock(mutex);
+    ready.wait(lock, [this]() { return done || ! blocks.empty(); });
+    if (blocks.empty())
+        return false;
+    outBlock = std::move(blocks.front());
+    blocks.pop_front();
+    space.notify_one();
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Wait for room in the read ahead queue, then queue block.
+void FileListReader::push(Block& block) {
+    std::unique_lock<std::mutex> lock(mutex);
+    space.wait(lock, [this]() { return stopping || blocks.size() < MAX_BLOCKS; });
+    blocks.push_back(std::move(block));
+    ready.notify_one();
+}
+
+// ---------------------------------------------------------------------------
+// Read BLOCK_SIZE at a time, split after the last delimiter and carry the partial
+// path over to the next block. A path longer than a block grows it until complete.
+void FileListReader::run() {
+    Block block;
+    size_t carry = 0;
+    for (;;) {
+        block.resize(carry + BLOCK_SIZE);
+        size_t got = fread(block.data() + carry, 1, BLOCK_SIZE, in);
+        size_t used = carry + got;
+        if (got == 0) {
+            if (carry != 0) {   // last path without delimiter
+                block.resize(carry);
+                block.push_back(delim);
+                carry = 0;
+            } else {
+                break;
+            }
+        } else {
+            size_t end = used;
+            while (end != 0 && block[end - 1] != delim)
+                end--;
+            if (end == 0) {
+                carry = used;
+                continue;
+            }
+            block.resize(used);
+            carry = used - end;
+        }
+
+        Block rest(block.end() - carry, block.end());
+        block.resize(block.size() - carry);
+        for (size_t idx = 0; idx < block.size(); idx++) {
+            if (block[idx] == delim) {
+                block[idx] = '\0';
+                if (delim == '\n' && idx != 0 && block[idx - 1] == '\r')
+                    block[idx - 1] = '\0';     // CRLF list, empty path follows and is skipped
+            }
+        }
+        push(block);
+        block = std::move(rest);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping || got == 0)
+            break;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    done = true;
+    ready.notify_all();
+}
@@ -0,0 +1,86 @@
+//-------------------------------------------------------------------------------------------------
+// File: filelist.hpp    Author: Dennis Lang
+//
+// Desc: Read a list of file paths, one per line or NUL terminated (find -print0),
+//       from a file or stdin.
+//
+//   A reader thread fills large blocks while the caller indexes the previous ones,
+//   each block holds only whole paths with their delimiter replaced by '\0'.
+//
+//      FileListReader reader("-", '\0');
+//      FileListReader::Block block;
+//      while (reader.next(block))
+//          for (const char* path = block.data(); path < block.data() + block.size(); path += strlen(path) + 1)
+//              ...
+//
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2024
+// https://landenlabs.com
+//
+// This file is part of lldup project.
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#include "ll_stdhdr.hpp"
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdio.h>
+
+class FileListReader {
+public:
+    typedef std::vector<char> Block;
+    static const size_t BLOCK_SIZE = 1 << 20;
+    static const size_t MAX_BLOCKS = 4;     // read ahead limit
+
+    // listPath "-" reads stdin, delim is '\n' or '\0'.
+    FileListReader(const lstring& listPath, char delim);
+    ~FileListReader();
+
+    bool isOpen() const {
+        return in != nullptr;
+    }
+    // Return next block of paths, false once the list is exhausted.
+    bool next(Block& outBlock);
+
+private:
+    void run();
+    void push(Block& block);
+
+    FILE* in = nullptr;
+    bool closeIn = false;
+    char delim;
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable ready;      // block queued or reader done
+    std::condition_variable space;      // block taken
+    std::deque<Block> blocks;
+    bool done = false;
+    bool stopping = false;
+};
@@ -0,0 +1,252 @@
+//-------------------------------------------------------------------------------------------------
+//
+// File: filestore.cpp   Author: Dennis Lang  Desc: Compact index of scanned files.
+//
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2024
+// https://landenlabs.com
+//
+// This file is part of lldup project.
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "filestore.hpp"
+#include "directory.hpp"
+#include "xxhash64.hpp"
+
+#include <algorithm>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+const StringPool::Id StringPool::NONE;
+const uint32_t FileStore::NO_DIR;
+const uint64_t FileStore::NO_SIZE;
+
+// ---------------------------------------------------------------------------
+StringPool::StringPool() {
+    slots.assign(1024, NONE);
+}
+
+// ---------------------------------------------------------------------------
+// Names are looked up by their hash, the text is only compared on a hash match.
+StringPool::Id StringPool::intern(const char* str, size_t len) {
+    uint32_t hash = (uint32_t)XXHash64::hash(str, len, 0);
+    size_t mask = slots.size() - 1;
+    for (size_t slot = hash & mask; ; slot = (slot + 1) & mask) {
+        Id id = slots[slot];
+        if (id == NONE) {
+            id = (Id)strings.size();
+            strings.push_back(arena.copy(str, len));
+            hashes.push_back(hash);
+            slots[slot] = id;
+            if (strings.size() * 2 > slots.size())
+                growSlots();
+            return id;
+        }
+        if (hashes[id] == hash && strncmp(strings[id], str, len) == 0 && strings[id][len] == '\0')
+            return id;
+    }
+}
+
+// ---------------------------------------------------------------------------
+void StringPool::growSlots() {
+    std::vector<Id> newSlots(slots.size() * 2, NONE);
+    size_t mask = newSlots.size() - 1;
+    for (Id id = 0; id < strings.size(); id++) {
+        size_t slot = hashes[id] & mask;
+        while (newSlots[slot] != NONE)
+            slot = (slot + 1) & mask;
+        newSlots[slot] = id;
+    }
+    slots.swap(newSlots);
+}
+
+// ---------------------------------------------------------------------------
+size_t StringPool::bytes() const {
+    return arena.reserved()
+        + strings.capacity() * sizeof(strings[0])
+        + hashes.capacity() * sizeof(hashes[0])
+        + slots.capacity() * sizeof(slots[0]);
+}
+
+// ---------------------------------------------------------------------------
+void StringPool::clear() {
+    strings.clear();
+    hashes.clear();
+    slots.assign(1024, NONE);
+    arena.release();
+}
+
+// ---------------------------------------------------------------------------
+// Only the distinct names are sorted by text, records are then placed with a
+// stable counting sort on the name's rank.
+void FileStore::byName(std::vector<uint32_t>& outOrder) const {
+    std::vector<StringPool::Id> sortedIds(names.size());
+    for (StringPool::Id id = 0; id < sortedIds.size(); id++)
+        sortedIds[id] = id;
+    std::sort(sortedIds.begin(), sortedIds.end(), [this](StringPool::Id a, StringPool::Id b) {
+        return strcmp(names.get(a), names.get(b)) < 0;
+    });
+
+    std::vector<uint32_t> start(names.size() + 1, 0);
+    std::vector<uint32_t> rank(names.size());
+    for (uint32_t pos = 0; pos < sortedIds.size(); pos++)
+        rank[sortedIds[pos]] = pos;
+    for (StringPool::Id nameId : nameIds)
+        start[rank[nameId] + 1]++;
+    for (size_t pos = 1; pos < start.size(); pos++)
+        start[pos] += start[pos - 1];
+
+    outOrder.resize(size());
+    for (uint32_t rec = 0; rec < size(); rec++)
+        outOrder[start[rank[nameIds[rec]]]++] = rec;
+}
+
+// ---------------------------------------------------------------------------
+void FileStore::statFiles() {
+    sizes.resize(size());
+    devs.resize(size());
+    inos.resize(size());
+    struct stat info;
+    lstring fullPath;
+    for (uint32_t rec = 0; rec < size(); rec++) {
+        if (stat(filePath(fullPath, rec), &info) == 0) {
+            sizes[rec] = (uint64_t)info.st_size;
+            devs[rec] = (uint64_t)info.st_dev;
+            inos[rec] = (uint64_t)info.st_ino;
+        } else {
+            sizes[rec] = NO_SIZE;
+            devs[rec] = inos[rec] = 0;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+template <class TT>
+static void keepColumn(std::vector<TT>& column, const std::vector<char>& keepRec) {
+    if (column.size() != keepRec.size()) {
+        column.clear();     // column not filled
+        return;
+    }
+    size_t outIdx = 0;
+    for (size_t rec = 0; rec < keepRec.size(); rec++) {
+        if (keepRec[rec])
+            column[outIdx++] = column[rec];
+    }
+    column.resize(outIdx);
+}
+
+// ---------------------------------------------------------------------------
+void FileStore::keep(const std::vector<char>& keepRec) {
+    if (! hashKinds.empty()) {
+        hashes.resize(size(), 0);    // known hashes are set sparsely
+        hashKinds.resize(size(), HASH_NONE);
+    }
+    keepColumn(nameIds, keepRec);
+    keepColumn(dirIds, keepRec);
+    keepColumn(sizes, keepRec);
+    keepColumn(devs, keepRec);
+    keepColumn(inos, keepRec);
+    keepColumn(hashes, keepRec);
+    keepColumn(hashKinds, keepRec);
+}
+
+// ---------------------------------------------------------------------------
+// One pass per key byte, a byte equal in every key is skipped, so small sizes
+// only cost a couple of passes.
+void FileStore::radixSort(std::vector<uint32_t>& order, const std::vector<uint64_t>& keys) {
+    std::vector<uint32_t> sorted(order.size());
+    size_t count[256];
+    for (unsigned shift = 0; shift < 64; shift += 8) {
+        memset(count, 0, sizeof(count));
+        for (uint32_t rec : order)
+            count[(keys[rec] >> shift) & 0xff]++;
+        if (order.empty() || count[(keys[order[0]] >> shift) & 0xff] == order.size())
+            continue;
+
+        size_t start = 0;
+        for (size_t& cnt : count) {
+            size_t next = start + cnt;
+            cnt = start;
+            start = next;
+        }
+        for (uint32_t rec : order)
+            sorted[count[(keys[rec] >> shift) & 0xff]++] = rec;
+        order.swap(sorted);
+    }
+}
+
+// ---------------------------------------------------------------------------
+uint32_t FileStore::addRoot(const lstring& rootPath) {
+    auto found = rootIds.find(rootPath);
+    if (found != rootIds.end())
+        return found->second;
+    uint32_t dirId = addDir(NO_DIR, rootPath);
+    rootIds[rootPath] = dirId;
+    return dirId;
+}
+
+// ---------------------------------------------------------------------------
+// Parents are appended first by recursion, no allocation beyond outPath.
+lstring& FileStore::dirPath(lstring& outPath, uint32_t dirId) const {
+    outPath.clear();
+    appendDir(outPath, dirId);
+    return outPath;
+}
+
+// ---------------------------------------------------------------------------
+void FileStore::appendDir(lstring& outPath, uint32_t dirId) const {
+    if (dirs[dirId].parentId != NO_DIR)
+        appendDir(outPath, dirs[dirId].parentId);
+    outPath += names.get(dirs[dirId].nameId);
+    if (outPath.empty() || outPath.back() != Directory_files::SLASH_CHAR)
+        outPath += Directory_files::SLASH_CHAR;
+}
+
+// ---------------------------------------------------------------------------
+size_t FileStore::bytes() const {
+    return names.bytes()
+        + nameIds.capacity() * sizeof(nameIds[0])
+        + dirIds.capacity() * sizeof(dirIds[0])
+        + sizes.capacity() * sizeof(sizes[0])
+        + devs.capacity() * sizeof(devs[0])
+        + inos.capacity() * sizeof(inos[0])
+        + hashes.capacity() * sizeof(hashes[0])
+        + hashKinds.capacity() * sizeof(hashKinds[0])
+        + dirs.capacity() * sizeof(DirRec);
+}
+
+// ---------------------------------------------------------------------------
+void FileStore::clear() {
+    names.clear();
+    nameIds.clear();
+    dirIds.clear();
+    sizes.clear();
+    devs.clear();
+    inos.clear();
+    hashes.clear();
+    hashKinds.clear();
+    dirs.clear();
+    rootIds.clear();
+}
@@ -0,0 +1,212 @@
+//-------------------------------------------------------------------------------------------------
+// File: filestore.hpp    Author: Dennis Lang
+//
+// Desc: Compact in-memory index of scanned files used by DupFiles.
+//
+//   StringPool  - each distinct name stored once in an arena, referred to by 32-bit id,
+//                 found through an open-addressing table keyed by the name's hash.
+//   FileStore   - file records stored as columns (name, directory, size, device, inode, hash)
+//                 indexed by a 32-bit record id, directories kept as (parentId, nameId)
+//                 nodes and rebuilt into paths when printed.
+//
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2024
+// https://landenlabs.com
+//
+// This file is part of lldup project.
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#include "ll_stdhdr.hpp"
+#include "arena.hpp"
+
+#include <vector>
+#include <string_view>
+#include <memory>
+#include <unordered_map>
+#include <stdint.h>
+#include <string.h>
+
+// Interned strings, copied into an arena and never freed until clear().
+class StringPool {
+public:
+    typedef uint32_t Id;
+    static const Id NONE = (Id)-1;
+
+    StringPool();
+
+    // Return id of str, adding it if new.
+    Id intern(const char* str, size_t len);
+    Id intern(const lstring& str) {
+        return intern(str.c_str(), str.length());
+    }
+    const char* get(Id id) const {
+        return strings[id];
+    }
+    size_t size() const {
+        return strings.size();
+    }
+    size_t bytes() const;
+    const Arena& storage() const {
+        return arena;
+    }
+    void clear();
+
+private:
+    std::vector<const char*> strings;   // by id
+    std::vector<uint32_t> hashes;       // by id, kept so the table can grow without rehashing text
+    std::vector<Id> slots;              // open addressing, linear probe, NONE when empty
+    Arena arena;                        // string text
+
+    void growSlots();
+};
+
+// Algorithm of a content hash. HASH_XXH64 is what XXHash64::compute returns, other
+// kinds come from checksum manifests, folded to 64 bits, and only compare to their own kind.
+enum HashKind : uint8_t {
+    HASH_NONE, HASH_XXH64, HASH_XXH32, HASH_XXH3, HASH_XXH128,
+    HASH_MD5, HASH_SHA1, HASH_SHA224, HASH_SHA256, HASH_SHA384, HASH_SHA512
+};
+
+// Directory node, a root holds its full path as name and has no parent.
+class DirRec {
+public:
+    uint32_t parentId;
+    StringPool::Id nameId;
+
+    DirRec(uint32_t _parentId, StringPool::Id _nameId) : parentId(_parentId), nameId(_nameId) {}
+};
+
+// Indexed files, grouped by name, size or hash on demand.
+// Columns are indexed by record id, sizes/devs/inos are filled by statFiles().
+class FileStore {
+public:
+    static const uint32_t NO_DIR = (uint32_t)-1;
+    static const uint64_t NO_SIZE = (uint64_t)-1;
+
+    StringPool names;
+    std::vector<StringPool::Id> nameIds;
+    std::vector<uint32_t> dirIds;
+    std::vector<uint64_t> sizes;    // NO_SIZE if stat failed
+    std::vector<uint64_t> devs;
+    std::vector<uint64_t> inos;     // 0 if file system has no inode numbers
+    std::vector<uint64_t> hashes;
+    std::vector<uint8_t> hashKinds; // HashKind of hashes known before the scan, HASH_NONE if not
+    std::vector<DirRec> dirs;       // parent always added before its children
+
+    size_t size() const {
+        return nameIds.size();
+    }
+    void add(std::string_view name, uint32_t dirId) {
+        nameIds.push_back(names.intern(name.data(), name.length()));
+        dirIds.push_back(dirId);
+    }
+    // Add with stat columns from the directory listing, they are kept only while
+    // every record has them, else statFiles() refills all.
+    void add(std::string_view name, uint32_t dirId, uint64_t size, uint64_t dev, uint64_t ino) {
+        bool filled = hasStat();
+        add(name, dirId);
+        if (filled) {
+            sizes.push_back(size);
+            devs.push_back(dev);
+            inos.push_back(ino);
+        }
+    }
+    // Set a known content hash, ex: from a manifest, of record rec.
+    void setHash(uint32_t rec, uint64_t hash, HashKind kind) {
+        hashes.resize(size(), 0);
+        hashKinds.resize(size(), HASH_NONE);
+        hashes[rec] = hash;
+        hashKinds[rec] = kind;
+    }
+    HashKind hashKind(uint32_t rec) const {
+        return (rec < hashKinds.size()) ? (HashKind)hashKinds[rec] : HASH_NONE;
+    }
+    uint32_t addDir(uint32_t parentId, const char* name) {
+        dirs.emplace_back(parentId, names.intern(name, strlen(name)));
+        return (uint32_t)dirs.size() - 1;
+    }
+    // Return id of root directory rootPath (full path), adding it if new.
+    uint32_t addRoot(const lstring& rootPath);
+
+    const char* name(uint32_t rec) const {
+        return names.get(nameIds[rec]);
+    }
+    lstring path(uint32_t rec) const {
+        return path(dirIds[rec], name(rec));
+    }
+    // Rebuild file path in outPath, no allocation once outPath has the capacity.
+    lstring& filePath(lstring& outPath, uint32_t rec) const {
+        dirPath(outPath, dirIds[rec]) += name(rec);
+        return outPath;
+    }
+    const char* dirName(uint32_t dirId) const {
+        return names.get(dirs[dirId].nameId);
+    }
+    // Rebuild directory path ending with slash.
+    lstring& dirPath(lstring& outPath, uint32_t dirId) const;
+    lstring path(uint32_t dirId, const char* name) const {
+        lstring outPath;
+        return dirPath(outPath, dirId) += name;
+    }
+
+    // Fill outOrder with record indices sorted by name then insertion order, so each
+    // run of equal nameId is one name group.
+    void byName(std::vector<uint32_t>& outOrder) const;
+
+    // Return end of the name group starting at order[pos].
+    size_t nameRun(const std::vector<uint32_t>& order, size_t pos) const {
+        StringPool::Id nameId = nameIds[order[pos]];
+        while (++pos < order.size() && nameIds[order[pos]] == nameId);
+        return pos;
+    }
+    // Fill outDirIds with the directories of the name group starting at order[pos], return its name.
+    const char* nameDirs(const std::vector<uint32_t>& order, size_t pos, std::vector<unsigned>& outDirIds) const {
+        outDirIds.clear();
+        size_t endPos = nameRun(order, pos);
+        for (; pos < endPos; pos++)
+            outDirIds.push_back(dirIds[order[pos]]);
+        return names.get(nameIds[order[endPos - 1]]);
+    }
+
+    // Fill size, device and inode columns.
+    void statFiles();
+    bool hasStat() const {
+        return sizes.size() == size();
+    }
+    // Keep records whose keepRec is set, record ids change.
+    void keep(const std::vector<char>& keepRec);
+
+    // Stable LSD radix sort of record ids in order by keys[id].
+    static void radixSort(std::vector<uint32_t>& order, const std::vector<uint64_t>& keys);
+
+    size_t bytes() const;
+    void clear();
+
+private:
+    void appendDir(lstring& outPath, uint32_t dirId) const;
+
+    std::unordered_map<std::string, uint32_t> rootIds;
+};
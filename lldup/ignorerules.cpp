@@ -0,0 +1,228 @@
+//-------------------------------------------------------------------------------------------------
+//
+// File: ignorerules.cpp   Author: Dennis Lang  Desc: .lldupignore rules.
+//
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2024
+// https://landenlabs.com
+//
+// This file is part of lldup project.
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "ignorerules.hpp"
+#include "directory.hpp"
+
+#include <fstream>
+
+const char* const IgnoreStack::FILE_NAME = ".lldupignore";
+
+// ---------------------------------------------------------------------------
+// Parse gitignore syntax, return false if the file could not be read.
+bool IgnoreRules::load(const lstring& filePath) {
+    std::ifstream in(filePath);
+    if (! in)
+        return false;
+
+    std::string line;
+    while (std::getline(in, line)) {
+        if (! line.empty() && line.back() == '\r')
+            line.pop_back();
+        // Trailing spaces are dropped unless escaped.
+        while (! line.empty() && line.back() == ' ' && (line.length() < 2 || line[line.length() - 2] != '\\'))
+            line.pop_back();
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        IgnoreRule rule;
+        size_t start = 0;
+        if (line[0] == '!') {
+            rule.negate = true;
+            start = 1;
+        } else if (line[0] == '\\' && line.length() > 1 && (line[1] == '!' || line[1] == '#')) {
+            start = 1;
+        }
+        std::string pattern = line.substr(start);
+        if (! pattern.empty() && pattern.back() == '/') {
+            rule.dirOnly = true;
+            pattern.pop_back();
+        }
+        rule.anchored = pattern.find('/') != std::string::npos;
+        if (! pattern.empty() && pattern[0] == '/')
+            pattern.erase(0, 1);
+        if (pattern.empty())
+            continue;
+        rule.pattern = pattern;
+        rules.push_back(rule);
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Last matching rule decides.
+IgnoreRules::Result IgnoreRules::match(std::string_view relPath, std::string_view name, bool isDir) const {
+    for (size_t idx = rules.size(); idx-- != 0; ) {
+        const IgnoreRule& rule = rules[idx];
+        if (rule.dirOnly && ! isDir)
+            continue;
+        if (pathMatch(rule.pattern, rule.anchored ? relPath : name))
+            return rule.negate ? KEEP : IGNORE;
+    }
+    return NONE;
+}
+
+// ---------------------------------------------------------------------------
+// Return length of the [...] class at pattern[0] and set matched, 0 if not a class.
+static size_t classMatch(std::string_view pattern, char chr, bool& matched) {
+    size_t pos = 1;
+    bool negate = (pos < pattern.length() && (pattern[pos] == '!' || pattern[pos] == '^'));
+    if (negate)
+        pos++;
+    bool found = false;
+    size_t first = pos;
+    while (pos < pattern.length() && (pattern[pos] != ']' || pos == first)) {
+        char lo = pattern[pos];
+        char hi = lo;
+        if (pos + 2 < pattern.length() && pattern[pos + 1] == '-' && pattern[pos + 2] != ']') {
+            hi = pattern[pos + 2];
+            pos += 2;
+        }
+        found |= (chr >= lo && chr <= hi);
+        pos++;
+    }
+    if (pos >= pattern.length())
+        return 0;   // no closing ']', '[' is literal
+    matched = (found != negate) && chr != '/';
+    return pos + 1;
+}
+
+// ---------------------------------------------------------------------------
+// [static]
+bool IgnoreRules::pathMatch(std::string_view pattern, std::string_view path) {
+    size_t pPos = 0;
+    size_t sPos = 0;
+    while (pPos < pattern.length()) {
+        char chr = pattern[pPos];
+        if (chr == '*') {
+            if (pPos + 1 < pattern.length() && pattern[pPos + 1] == '*') {
+                pPos += 2;
+                if (pPos < pattern.length() && pattern[pPos] == '/') {
+                    // "**/" matches zero or more whole directories.
+                    std::string_view rest = pattern.substr(pPos + 1);
+                    for (size_t at = sPos; ; at++) {
+                        if (pathMatch(rest, path.substr(at)))
+                            return true;
+                        at = path.find('/', at);
+                        if (at == std::string_view::npos)
+                            return false;
+                    }
+                }
+                std::string_view rest = pattern.substr(pPos);
+                for (size_t at = sPos; at <= path.length(); at++) {
+                    if (pathMatch(rest, path.substr(at)))
+                        return true;
+                }
+                return false;
+            }
+            // '*' matches within one path part.
+            std::string_view rest = pattern.substr(pPos + 1);
+            for (size_t at = sPos; ; at++) {
+                if (pathMatch(rest, path.substr(at)))
+                    return true;
+                if (at >= path.length() || path[at] == '/')
+                    return false;
+            }
+        }
+        if (sPos >= path.length())
+            return false;
+
+        if (chr == '?') {
+            if (path[sPos] == '/')
+                return false;
+        } else if (chr == '[') {
+            bool matched = false;
+            size_t classLen = classMatch(pattern.substr(pPos), path[sPos], matched);
+            if (classLen != 0) {
+                if (! matched)
+                    return false;
+                pPos += classLen;
+                sPos++;
+                continue;
+            }
+            if (path[sPos] != chr)
+                return false;
+        } else {
+            if (chr == '\\' && pPos + 1 < pattern.length())
+                chr = pattern[++pPos];
+            if (path[sPos] != chr)
+                return false;
+        }
+        pPos++;
+        sPos++;
+    }
+    return sPos == path.length();
+}
+
+// ---------------------------------------------------------------------------
+void IgnoreStack::load(const lstring& dirPath) {
+    if (! frames.empty() && frames.back().depth == marks.size())
+        return;     // already loaded for this directory
+
+    Frame frame;
+    lstring filePath;
+    DirUtil::join(filePath, dirPath, FILE_NAME);
+    if (frame.rules.load(filePath) && ! frame.rules.rules.empty()) {
+        frame.depth = marks.size();
+        frame.baseLen = relPath.length();
+        frames.push_back(std::move(frame));
+    }
+}
+
+// ---------------------------------------------------------------------------
+void IgnoreStack::push(std::string_view dirName) {
+    marks.push_back(relPath.length());
+    relPath.append(dirName.data(), dirName.length());
+    relPath += '/';
+}
+
+// ---------------------------------------------------------------------------
+void IgnoreStack::pop() {
+    if (! frames.empty() && frames.back().depth == marks.size())
+        frames.pop_back();
+    relPath.resize(marks.back());
+    marks.pop_back();
+}
+
+// ---------------------------------------------------------------------------
+// Innermost rule file with a matching rule decides.
+bool IgnoreStack::ignored(std::string_view name, bool isDir) const {
+    for (size_t idx = frames.size(); idx-- != 0; ) {
+        const Frame& frame = frames[idx];
+        matchPath.assign(relPath, frame.baseLen, lstring::npos);
+        matchPath.append(name.data(), name.length());
+        IgnoreRules::Result result = frame.rules.match(matchPath, name, isDir);
+        if (result != IgnoreRules::NONE)
+            return result == IgnoreRules::IGNORE;
+    }
+    return false;
+}
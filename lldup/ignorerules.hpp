@@ -0,0 +1,106 @@
+//-------------------------------------------------------------------------------------------------
+// File: ignorerules.hpp    Author: Dennis Lang
+//
+// Desc: .lldupignore files (gitignore syntax) honored while walking a tree.
+//
+//      # comment           blank lines and comments are skipped
+//      *.o                 no slash, matches the name at any depth below the file
+//      build/              trailing slash, directories only
+//      /out                leading or inner slash, anchored to the file's directory
+//      docs/**/*.tmp       ** matches any number of directories
+//      !keep.o             negation, re-includes a name ignored by an earlier rule
+//
+//   Rules of a directory are parsed once when the walk enters it and apply to everything
+//   below it. A deeper file overrides its parents and the last matching rule wins.
+//   An ignored directory is never opened, so nothing below it can be re-included.
+//
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2024
+// https://landenlabs.com
+//
+// This file is part of lldup project.
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#include "ll_stdhdr.hpp"
+
+#include <vector>
+#include <string>
+#include <string_view>
+
+// One rule line.
+class IgnoreRule {
+public:
+    std::string pattern;    // without '!', leading '/' and trailing '/'
+    bool negate = false;
+    bool dirOnly = false;
+    bool anchored = false;  // matched against the path relative to the rule file's directory
+};
+
+// Rules of one .lldupignore file.
+class IgnoreRules {
+public:
+    enum Result { NONE, IGNORE, KEEP };
+
+    std::vector<IgnoreRule> rules;
+
+    bool load(const lstring& filePath);
+    // relPath is name prefixed by its directories below the rule file.
+    Result match(std::string_view relPath, std::string_view name, bool isDir) const;
+
+    // Match path against pattern, '*' and '?' stop at '/', '**' spans directories, [a-z] class.
+    static bool pathMatch(std::string_view pattern, std::string_view path);
+};
+
+// Rules in effect while walking one tree, with a frame per directory holding a rule file.
+// Not thread safe, each walk (or root of a DupScan) keeps its own stack.
+class IgnoreStack {
+public:
+    static const char* const FILE_NAME;     // ".lldupignore"
+
+    // Load dirPath/.lldupignore for the current directory, once per directory.
+    void load(const lstring& dirPath);
+    // Descend into subdirectory dirName, or return to the parent dropping its rules.
+    void push(std::string_view dirName);
+    void pop();
+
+    bool empty() const {
+        return frames.empty();
+    }
+    // True if name in the current directory is ignored.
+    bool ignored(std::string_view name, bool isDir) const;
+
+private:
+    class Frame {
+    public:
+        IgnoreRules rules;
+        size_t depth;       // directory holding the rule file
+        size_t baseLen;     // relPath length at that directory
+    };
+    std::vector<Frame> frames;
+    std::vector<size_t> marks;      // relPath length before each push
+    lstring relPath;                // current directory below the walk root, ends with '/'
+    mutable lstring matchPath;      // scratch for ignored()
+};
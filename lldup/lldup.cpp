@@ -43,10 +43,16 @@
 #include "commands.hpp"
 #include "directory.hpp"
 #include "dupscan.hpp"
+#include "ignorerules.hpp"
+#include "filelist.hpp"
+#include "manifest.hpp"
 
 #include <assert.h>
 #include <iostream>
 #include <exception>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
 #if 0
 #include <stdio.h>
 #include <ctype.h>
@@ -69,35 +75,352 @@ typedef unsigned int uint;
 
 
 // ---------------------------------------------------------------------------
-// Search directories, locate files.
-static size_t InspectFiles(Command& command, const lstring& dirname) {
-    Directory_files directory(dirname);
-    lstring fullname;
+// Entries of one directory, names packed in one buffer. One listing per tree depth
+// is reused for every directory at that depth.
+class DirListing {
+public:
+    lstring names;                      // each name followed by its terminator
+    std::vector<size_t> fileNames;      // offset in names, by files index
+    std::vector<size_t> subDirs;        // offset in names
+    std::vector<uint64_t> subDevs;      // device by subDirs index, when mounts or links are checked
+    std::vector<uint64_t> subInos;      // inode by subDirs index, when links are followed
+    std::vector<Command::Entry> files;
+
+    void clear() {
+        names.clear();
+        fileNames.clear();
+        subDirs.clear();
+        subDevs.clear();
+        subInos.clear();
+        files.clear();
+    }
+    size_t addName(const char* name) {
+        size_t offset = names.length();
+        names.append(name, strlen(name) + 1);
+        return offset;
+    }
+};
+typedef std::deque<DirListing> ListingStack;    // deque keeps listing references stable
+
+// Directories already walked by (device, inode), so with -followLinks a link cycle
+// ends and a directory reached by several paths is listed once. Files are not
+// tracked, hard links are left to the duplicate report.
+class VisitedSet {
+public:
+    // Return true and mark (dev, ino) visited if new, always true without an inode.
+    bool visit(uint64_t dev, uint64_t ino) {
+        return ino == 0 || seen.emplace(dev, ino).second;
+    }
+
+private:
+    struct DevInoHash {
+        size_t operator()(const std::pair<uint64_t, uint64_t>& devIno) const {
+            return std::hash<uint64_t>()(devIno.second * 0x9E3779B97F4A7C15ULL ^ devIno.first);
+        }
+    };
+    std::unordered_set<std::pair<uint64_t, uint64_t>, DevInoHash> seen;
+};
+
+// ---------------------------------------------------------------------------
+// List directory, hand its files to the command as one batch, then descend. All files of a
+// directory are added before those of its subdirectories, not in listing order.
+// dirPath holds the directory path and is extended in place for each subdirectory.
+// Names ignored by .lldupignore rules are dropped, ignored subdirectories never opened.
+// dirDev is the directory's device, a subdirectory on another device is a mount point.
+// Links to directories are walked only with -followLinks, each target once.
+static size_t InspectDir(Command& command, Directory_files& directory, PathBuf& dirPath, unsigned dirId,
+        uint64_t dirDev, ListingStack& listings, size_t depth, IgnoreStack& ignore, VisitedSet& visited) {
+    if (listings.size() <= depth)
+        listings.emplace_back();
+    DirListing& listing = listings[depth];
+    listing.clear();
+
+    bool needInfo = command.needInfo();
+    bool filterInfo = command.hasInfoFilter();
+    bool followLinks = command.followLinks;
+    bool trackDirs = followLinks || command.hasMountFilter();
+    bool hasIgnoreFile = false;
+    struct stat info;
+    while (!Signals::aborted && directory.more()) {
+        bool isDir = directory.is_directory();
+        bool hasInfo = false;
+        if (directory.is_link()) {
+            hasInfo = directory.getInfo(info);    // of the link target
+            isDir = hasInfo && S_ISDIR(info.st_mode);
+            if (isDir && ! followLinks) {
+                command.pruneCnt++;
+                continue;
+            }
+        }
+        if (isDir) {
+            listing.subDirs.push_back(listing.addName(directory.name()));
+            if (trackDirs) {
+                hasInfo = hasInfo || directory.getInfo(info);
+                listing.subDevs.push_back(hasInfo ? (uint64_t)info.st_dev : dirDev);
+                listing.subInos.push_back(hasInfo ? (uint64_t)info.st_ino : 0);
+            }
+        } else {
+            hasIgnoreFile |= strcmp(directory.name(), IgnoreStack::FILE_NAME) == 0;
+            Command::Entry entry;
+            entry.dirId = dirId;
+            if (needInfo && (hasInfo || directory.getInfo(info))) {
+                entry.size = (uint64_t)info.st_size;
+                entry.mtime = info.st_mtime;
+                entry.dev = (uint64_t)info.st_dev;
+                entry.ino = (uint64_t)info.st_ino;
+            }
+            if (filterInfo && ! command.validInfo(entry.size, entry.mtime))
+                continue;   // outside size or age range, never stored
+            size_t nameOff = listing.addName(directory.name());
+            listing.fileNames.push_back(nameOff);
+            listing.files.push_back(entry);
+        }
+    }
+
+    if (hasIgnoreFile)
+        ignore.load(dirPath.str());
+
+    // Names buffer is complete, point the entries into it.
+    size_t keepCnt = 0;
+    for (size_t idx = 0; idx < listing.files.size(); idx++) {
+        const char* name = listing.names.c_str() + listing.fileNames[idx];
+        if (! ignore.empty() && ignore.ignored(name, false)) {
+            command.skipCnt++;
+            continue;
+        }
+        listing.files[keepCnt] = listing.files[idx];
+        listing.files[keepCnt++].name = std::string_view(name, strlen(name));
+    }
+    listing.files.resize(keepCnt);
+    size_t fileCount = command.addBatch(dirPath, listing.files.data(), listing.files.size());
+
+    for (size_t subIdx = 0; subIdx < listing.subDirs.size(); subIdx++) {
+        if (Signals::aborted)
+            break;
+        const char* name = listing.names.c_str() + listing.subDirs[subIdx];
+        uint64_t subDev = trackDirs ? listing.subDevs[subIdx] : dirDev;
+        if (! ignore.empty() && ignore.ignored(name, true)) {
+            command.pruneCnt++;
+            continue;
+        }
+        if (! command.validDir(name))
+            continue;
+        size_t mark = dirPath.push(name);
+        if (! command.validMount(dirPath.str().c_str(), subDev, dirDev)) {
+            dirPath.truncate(mark);
+            continue;
+        }
+        if (followLinks && ! visited.visit(subDev, listing.subInos[subIdx])) {
+            command.pruneCnt++;     // link cycle or directory already walked
+            dirPath.truncate(mark);
+            continue;
+        }
+        Directory_files subDirectory(dirPath.str());
+        ignore.push(name);
+        fileCount += InspectDir(command, subDirectory, dirPath, command.addDir(dirId, name), subDev,
+            listings, depth + 1, ignore, visited);
+        ignore.pop();
+        dirPath.truncate(mark);
+    }
 
+    return fileCount;
+}
+
+// ---------------------------------------------------------------------------
+// Search directories, locate files. visited is shared by all roots of the run.
+static size_t InspectFiles(Command& command, const lstring& dirname, VisitedSet& visited) {
     size_t fileCount = 0;
 
     struct stat filestat;
     try {
         if (stat(dirname, &filestat) == 0 && S_ISREG(filestat.st_mode)) {
-            fileCount += command.add(dirname);
+            if (! command.hasInfoFilter() || command.validInfo(filestat.st_size, filestat.st_mtime))
+                fileCount += command.add(dirname);
             return fileCount;
         }
     } catch (exception ex) {
         // Probably a pattern, let directory scan do its magic.
     }
 
-    while (!Signals::aborted && directory.more()) {
-        directory.fullName(fullname);
-        if (directory.is_directory()) {
-            fileCount += InspectFiles(command, fullname);
-        } else if (fullname.length() > 0) {
-            fileCount += command.add(fullname);
-        }
+    // Same full path Directory_files gives its entries.
+    lstring rootDir;
+    if (! DirUtil::fileExists(dirname))
+        DirUtil::getDir(rootDir, dirname);     // remove wildcard
+    else
+        rootDir = dirname;
+    DirUtil::fullPath(rootDir, rootDir);
+
+    Directory_files directory(dirname);
+    PathBuf dirPath(rootDir);
+    ListingStack listings;
+    IgnoreStack ignore;
+    uint64_t rootDev = 0;
+    if (stat(rootDir, &filestat) == 0) {
+        rootDev = (uint64_t)filestat.st_dev;
+        if (command.followLinks)
+            visited.visit(rootDev, (uint64_t)filestat.st_ino);    // walked even if already marked
+    }
+    return InspectDir(command, directory, dirPath, command.addDir(Command::NO_DIR, rootDir), rootDev,
+        listings, 0, ignore, visited);
+}
+
+// ---------------------------------------------------------------------------
+typedef std::unordered_map<std::string, unsigned> DirIdMap;
+
+// Return id of listed directory dir, adding it and its missing parents by splitting the
+// path, so listed directories keep their parent links. Nothing is stat'ed.
+static unsigned listDirId(Command& command, DirIdMap& dirIds, const std::string& dir) {
+    auto found = dirIds.find(dir);
+    if (found != dirIds.end())
+        return found->second;
+    size_t slash = dir.find_last_of(SLASH_CHAR == '/' ? "/" : "/\\");
+    unsigned dirId;
+    if (slash == std::string::npos || slash + 1 == dir.length()) {
+        dirId = command.addRoot(dir);
+    } else {
+        unsigned parentId = listDirId(command, dirIds, dir.substr(0, (slash == 0) ? 1 : slash));
+        dirId = command.addDir(parentId, dir.substr(slash + 1));
     }
+    dirIds[dir] = dirId;
+    return dirId;
+}
 
+// ---------------------------------------------------------------------------
+// Index the files named by a path list. Consecutive paths of one directory go to the
+// command as one batch, directories are never listed and only stat'ed files are
+// checked to be regular, ex: find dir -type f -print0 | lldup -0
+// Directories are registered from the listed paths as given, never stat'ed or resolved.
+// With a manifest (baseDir is its directory) each line also carries the content hash,
+// and maybe the size, and relative paths are below baseDir.
+static size_t InspectFileList(Command& command, FileListReader& reader, const char* baseDir = nullptr) {
+    // Relative paths of a plain list are below the working directory, resolved once.
+    bool isManifest = baseDir != nullptr;
+    lstring workDir;
+    if (! isManifest)
+        baseDir = DirUtil::fullPath(workDir, ".").c_str();
+    bool needInfo = command.needInfo();
+    bool filterInfo = command.hasInfoFilter();
+    ManifestLine line;
+    lstring fullDir;
+    DirIdMap dirIds;
+    std::vector<Command::Entry> entries;
+    std::string batchDir;
+    unsigned dirId = Command::NO_DIR;
+    PathBuf dirPath;
+    size_t fileCount = 0;
+    struct stat info;
+
+    FileListReader::Block block;
+    while (! Signals::aborted && reader.next(block)) {
+        const char* endPtr = block.data() + block.size();
+        size_t lineLen;
+        for (char* linePtr = block.data(); linePtr < endPtr; linePtr += lineLen + 1) {
+            lineLen = strlen(linePtr);
+            const char* path = linePtr;
+            if (isManifest) {
+                if (! Manifest::parseLine(linePtr, line))
+                    continue;
+                path = line.path;
+            }
+            size_t pathLen = strlen(path);
+            if (pathLen == 0)
+                continue;
+            const char* namePtr = path + pathLen;
+            while (namePtr != path && namePtr[-1] != '/' && namePtr[-1] != SLASH_CHAR)
+                namePtr--;
+            std::string_view dir(path, namePtr - path);
+            if (dir.length() > 1)
+                dir.remove_suffix(1);           // keep the slash of a root only
+            else if (dir.empty())
+                dir = ".";
+            if (dirId == Command::NO_DIR || dir != batchDir) {
+                fileCount += command.addBatch(dirPath, entries.data(), entries.size());
+                entries.clear();
+                batchDir.assign(dir);
+                fullDir = batchDir;
+                bool isAbsolute = batchDir[0] == '/' || batchDir[0] == SLASH_CHAR || batchDir[1] == ':';
+                if (! isAbsolute) {
+                    const char* relDir = batchDir.c_str();
+                    while (relDir[0] == '.' && (relDir[1] == '/' || relDir[1] == SLASH_CHAR))
+                        relDir += 2;    // find . lists ./dir/name
+                    DirUtil::join(fullDir, baseDir, strcmp(relDir, ".") == 0 ? "" : relDir);
+                }
+                if (fullDir.length() > 1 && (fullDir.back() == '/' || fullDir.back() == SLASH_CHAR))
+                    fullDir.pop_back();
+                dirId = listDirId(command, dirIds, fullDir);
+                dirPath.setRoot(fullDir.c_str());
+            }
+
+            Command::Entry entry;
+            entry.dirId = dirId;
+            entry.name = std::string_view(namePtr, path + pathLen - namePtr);
+            if (isManifest) {
+                entry.hash = line.hash;
+                entry.hashKind = line.kind;
+                entry.size = line.size;
+            }
+            if (filterInfo || (needInfo && entry.size == Command::NO_SIZE)) {
+                size_t mark = dirPath.push(namePtr);
+                bool isFile = stat(dirPath.str(), &info) == 0 && S_ISREG(info.st_mode);
+                dirPath.truncate(mark);
+                if (! isFile) {
+                    command.skipCnt++;
+                    continue;
+                }
+                entry.size = (uint64_t)info.st_size;
+                entry.mtime = info.st_mtime;
+                entry.dev = (uint64_t)info.st_dev;
+                entry.ino = (uint64_t)info.st_ino;
+            }
+            if (filterInfo && ! command.validInfo(entry.size, entry.mtime))
+                continue;
+            entries.push_back(entry);
+        }
+        // Names point into block, hand them over before it is replaced.
+        fileCount += command.addBatch(dirPath, entries.data(), entries.size());
+        entries.clear();
+    }
     return fileCount;
 }
 
+// ---------------------------------------------------------------------------
+// Parse file length with optional K, M, G or T suffix (1024 based), ex: 4K
+static uint64_t parseSize(const char* value) {
+    char* endPtr;
+    double size = strtod(value, &endPtr);
+    switch (toupper(*endPtr)) {
+    case 'T': size *= 1024;     // fall through
+    case 'G': size *= 1024;     // fall through
+    case 'M': size *= 1024;     // fall through
+    case 'K': size *= 1024;
+    }
+    return (uint64_t)size;
+}
+
+// ---------------------------------------------------------------------------
+// Parse modify time, a date yyyy-mm-dd (local) or an age before now as
+// <number>[s|m|h|d], days if no unit, ex: 12h
+static time_t parseTime(const char* value) {
+    int year, month, day;
+    if (sscanf(value, "%d-%d-%d", &year, &month, &day) == 3) {
+        struct tm TM = {};
+        TM.tm_year = year - 1900;
+        TM.tm_mon = month - 1;
+        TM.tm_mday = day;
+        TM.tm_isdst = -1;
+        return mktime(&TM);
+    }
+    char* endPtr;
+    double age = strtod(value, &endPtr);
+    switch (*endPtr) {
+    case 's': break;
+    case 'm': age *= 60; break;
+    case 'h': age *= 60 * 60; break;
+    default:  age *= 24 * 60 * 60; break;
+    }
+    return time(nullptr) - (time_t)age;
+}
+
 // ---------------------------------------------------------------------------
 void showHelp(const char* arg0) {
     const char* helpMsg = "  Dennis Lang v3.4 (landenlabs.com) " __DATE__ "\n\n"
@@ -114,21 +437,49 @@ void showHelp(const char* arg0) {
         //    "   -invert           ; Invert test output "
         "   -includeFile=<filePattern>\n"
         "   -excludeFile=<filePattern>\n"
+        "   -includeDir=<dirPattern>   ; Only descend into subdirectories matching pattern \n"
+        "   -excludeDir=<dirPattern>   ; Skip subdirectories matching pattern, ex: -excludeDir=.git \n"
+        "   -patternFile=<file>        ; Lines of includeFile=, excludeFile=, includeDir=, excludeDir=<pat> \n"
+        "                              ;   or <pat> to exclude file \n"
+        "   -minSize=<bytes>           ; Skip smaller files, K M G suffix, ex: -minSize=4K \n"
+        "   -maxSize=<bytes>           ; Skip larger files \n"
+        "   -newer=<age|date>          ; Only files modified after, age <n>[s|m|h|d] (def days) or yyyy-mm-dd \n"
+        "   -older=<age|date>          ; Only files modified before \n"
+        "   -xdev                      ; Don't descend into directories on other file systems \n"
+        "   -skipFs=<type>,...         ; Also skip mounts of these types, ex: -skipFs=tmpfs,nfs \n"
+        "   -allFs                     ; Walk all file systems, default skips proc, sysfs, cgroup, devpts... \n"
+        "   -followLinks               ; Walk linked directories, each directory visited once \n"
+        "   -files-from=<file|->       ; Index files named in list, one per line, and any dirs given \n"
+        "   -0                         ; List is NUL terminated (find -print0), stdin if no -files-from \n"
+        "   -manifest=<file>           ; Index files of an xxhsum, md5sum or sha256sum list with their hash, no read \n"
         "   -verbose \n"
         "\n"
         "_p_Options:\n"
         "   -_y_showAll           ; Show files that differ\n"
         "   -_y_showDiff           ; Show files that differ\n"
         "   -_y_showMiss           ; Show missing files \n"
+        "   -_y_missFiles          ; List each file of a missing directory, default one line per directory \n"
+        "   -_y_moves              ; With 2 dirs, pair missing files by content, show as moved \n"
+        "   -_y_replicas           ; Compare 3 or more trees by relative path, show P/D/M matrix per file \n"
+        "   -_y_quick[=<sec>]      ; Same size and modify time (within sec) is a duplicate, no content read \n"
+        "   -_y_deep=<days>        ; With -quick, content check 1/days of the files each day \n"
+        "   -_y_merkle             ; Skip subtrees with matching name/size/time digests \n"
+        "                           unchanged dirs listed once, differing twice, a tree past 64K dirs \n"
+        "                           relists its deepest subtrees once per level the walk descends \n"
+        "   -_y_digestStore=<file> ; Keep content hashes between runs, reused while size and time match \n"
+        "   -_y_writeManifest=<file>  ; Save path, size, time, hash of 1 dir, binary or text if .txt \n"
+        "   -_y_verifyManifest=<file> ; Compare 1 dir to a saved manifest, only the dir is read \n"
         "   -_y_hideDup            ; Don't show duplicate files \n"
         "\n"
         "   -_y_allFiles           ; Compare all files for matching hash \n"
+        "   -_y_dupDirs            ; Report duplicate directories as one group, hide their files \n"
         "   -_y_justName           ; Match duplicate name only, not contents \n"
         "   -_y_ignoreExtn            ; With -justName, also ignore extension \n"
         "\n"
         "   -_y_preDup=<text>      ; Prefix before duplicates, default: \"==\"  \n"
         "   -_y_preDiff=<text>     ; Prefix before differences, default: \"!= \"  \n"
         "   -_y_preMiss=<text>     ; Prefix before missing, default: \"--  \" \n"
+        "   -_y_preMoved=<text>    ; Prefix before moved, default: \"moved: \" \n"
         // "   -_y_preDivider=<text>  ; Pre group divider output before groups  \n"
         "   -_y_postDivider=<text> ; Divider for dup and diff, def: \"__\\n\"  \n"
         "   -_y_separator=<text>   ; Separator  \n"
@@ -142,6 +493,11 @@ void showHelp(const char* arg0) {
         "   lldup  dir1 dir2/subdir  \n"
         "   lldup  -_y_showDiff     dir1 dir2/subdir  \n"
         "   lldup  -_y_hideDup -_y_showMiss -_y_showDiff dir1 dir2/subdir  \n"
+        "  Check replicas, matrix column per tree: P=present, D=different, M=missing \n"
+        "   lldup  -_y_replicas -_y_showAll site1 site2 site3  \n"
+        "  Check a backup against the manifest saved when it was made \n"
+        "   lldup  -_y_writeManifest=backup.lldupmf backup  \n"
+        "   lldup  -_y_verifyManifest=backup.lldupmf -_y_showAll backup  \n"
         "  Find file matches by mtching hash value, slower than above, 1 or more dirs \n"
         "   lldup  -_y_showAll  dir1   dir2/subdir   dir3 \n"
         "   lldup  -_y_showAll  dir1 \n"
@@ -167,6 +523,9 @@ int main(int argc, char* argv[]) {
     Command* commandPtr = &dupFiles;
     StringList fileDirList;
     lstring timeStr;
+    lstring filesFrom;          // path list file, "-" for stdin
+    char listDelim = '\n';
+    StringList manifests;       // checksum manifests, files indexed with their hashes
 
     if (argc == 1) {
         showHelp(argv[0]);
@@ -185,19 +544,55 @@ int main(int argc, char* argv[]) {
                     if (cmd.length() > 2 && *cmdName == '-')
                         cmdName++;  // allow -- prefix on commands
                     switch (*cmdName) {
-                    case 'e':   // excludeFile=<pat>
-                        parser.validPattern(commandPtr->excludeFilePatList, value, "excludeFile", cmdName);
+                    case 'd':   // deep=<days>
+                        if (parser.validOption("deep", cmdName, false)) {
+                            commandPtr->deepDays = (unsigned)strtoul(value, nullptr, 10);
+                        } else if (parser.validOption("digestStore", cmdName)) {
+                            commandPtr->digestStore = value;
+                        }
+                        break;
+                    case 'e':   // excludeFile=<pat>, excludeDir=<pat>
+                        if (! parser.validPattern(commandPtr->excludeFilePatList, value, "excludeFile", cmdName, false))
+                            parser.validPattern(commandPtr->excludeDirPatList, value, "excludeDir", cmdName);
+                        break;
+                    case 'f':   // files-from=<file|->
+                        if (parser.validOption("files-from", cmdName)) {
+                            filesFrom = value;
+                        }
                         break;
-                    case 'i':   // includeFile=<pat>
-                        parser.validPattern(commandPtr->includeFilePatList, value, "includeFile", cmdName);
+                    case 'i':   // includeFile=<pat>, includeDir=<pat>
+                        if (! parser.validPattern(commandPtr->includeFilePatList, value, "includeFile", cmdName, false))
+                            parser.validPattern(commandPtr->includeDirPatList, value, "includeDir", cmdName);
                         break;
                     case 'l':   // log=[1|2]
                         if (parser.validOption("log", cmdName)) {
                             commandPtr->logfile = (unsigned)strtoul(value, nullptr, 10);
                         }
                         break;
+                    case 'm':   // manifest=<file>, maxSize=<bytes>, minSize=<bytes>
+                        if (parser.validOption("manifest", cmdName, false)) {
+                            manifests.push_back(value);
+                        } else if (parser.validOption("maxSize", cmdName, false)) {
+                            commandPtr->maxSize = parseSize(value);
+                        } else if (parser.validOption("minSize", cmdName)) {
+                            commandPtr->minSize = parseSize(value);
+                        }
+                        break;
+                    case 'n':   // newer=<age|date>
+                        if (parser.validOption("newer", cmdName)) {
+                            commandPtr->newerThan = parseTime(value);
+                        }
+                        break;
+                    case 'o':   // older=<age|date>
+                        if (parser.validOption("older", cmdName)) {
+                            commandPtr->olderThan = parseTime(value);
+                        }
+                        break;
                     case 'p':
-                        if (parser.validOption("postDivider", cmdName, false)) {
+                        if (parser.validPatternFile(commandPtr->includeFilePatList, commandPtr->excludeFilePatList,
+                                commandPtr->includeDirPatList, commandPtr->excludeDirPatList, value, "patternFile", cmdName, false)) {
+                            // include/exclude lists loaded
+                        } else if (parser.validOption("postDivider", cmdName, false)) {
                             commandPtr->postDivider = ParseUtil::convertSpecialChar(value);
                         } else if (parser.validOption("preDivider", cmdName)) {
                             commandPtr->preDivider = ParseUtil::convertSpecialChar(value);
@@ -205,13 +600,34 @@ int main(int argc, char* argv[]) {
                             commandPtr->preDup = ParseUtil::convertSpecialChar(value);
                         } else if (parser.validOption("preDiffer", cmdName)) {
                             commandPtr->preDiff = ParseUtil::convertSpecialChar(value);
-                        } else if (parser.validOption("preMissing", cmdName)) {
+                        } else if (parser.validOption("preMissing", cmdName, false)) {
                             commandPtr->preMissing = ParseUtil::convertSpecialChar(value);
+                        } else if (parser.validOption("preMoved", cmdName)) {
+                            commandPtr->preMoved = ParseUtil::convertSpecialChar(value);
+                        }
+                        break;
+                    case 'q':   // quick=<seconds>
+                        if (parser.validOption("quick", cmdName)) {
+                            commandPtr->quick = true;
+                            commandPtr->quickSec = (unsigned)strtoul(value, nullptr, 10);
                         }
                         break;
                     case 's':
                         if (parser.validOption("separator", cmdName, false)) {
                             commandPtr->separator = ParseUtil::convertSpecialChar(value);
+                        } else if (parser.validOption("skipFs", cmdName)) {  // skipFs=tmpfs,nfs
+                            for (const lstring& fsType : Split(value, ","))
+                                commandPtr->skipFsTypes.push_back(fsType);
+                        }
+                        break;
+                    case 'v':   // verifyManifest=<file>
+                        if (parser.validOption("verifyManifest", cmdName)) {
+                            commandPtr->verifyManifest = value;
+                        }
+                        break;
+                    case 'w':   // writeManifest=<file>
+                        if (parser.validOption("writeManifest", cmdName)) {
+                            commandPtr->writeManifest = value;
                         }
                         break;
 
@@ -224,14 +640,28 @@ int main(int argc, char* argv[]) {
                     if (argStr.length() > 2 && *cmdName == '-')
                         cmdName++;  // allow -- prefix on commands
                     switch (*cmdName) {
+                    case '0':   // NUL terminated path list
+                        if (parser.validOption("0", cmdName)) {
+                            listDelim = '\0';
+                        }
+                        break;
                     case 'a':
-                        if (parser.validOption("allFiles", cmdName)) {
+                        if (parser.validOption("allFiles", cmdName, false)) {
                             commandPtr->sameName = false;
+                        } else if (parser.validOption("allFs", cmdName)) {
+                            commandPtr->skipFsTypes.clear();
+                        }
+                        break;
+                    case 'd':
+                        if (parser.validOption("dupDirs", cmdName)) {
+                            commandPtr->dupDirs = true;
                         }
                         break;
                     case 'f': // duplicated files
-                        if (parser.validOption("files", cmdName)) {
+                        if (parser.validOption("files", cmdName, false)) {
                             commandPtr = &dupFiles.share(*commandPtr);
+                        } else if (parser.validOption("followLinks", cmdName)) {
+                            commandPtr->followLinks = true;
                         }
                         break;
                     case '?':
@@ -256,6 +686,25 @@ int main(int argc, char* argv[]) {
                             commandPtr->justName = true;
                         }
                         break;
+                    case 'm':
+                        if (parser.validOption("merkle", cmdName, false)) {
+                            commandPtr->merkle = true;
+                        } else if (parser.validOption("missFiles", cmdName, false)) {
+                            commandPtr->missFiles = true;
+                        } else if (parser.validOption("moves", cmdName)) {
+                            commandPtr->moves = true;
+                        }
+                        break;
+                    case 'q':
+                        if (parser.validOption("quick", cmdName)) {
+                            commandPtr->quick = true;
+                        }
+                        break;
+                    case 'r':
+                        if (parser.validOption("replicas", cmdName)) {
+                            commandPtr->replicas = true;
+                        }
+                        break;
                     case 's':
                         if (parser.validOption("showAll", cmdName, false)) {
                             commandPtr->showSame = commandPtr->showDiff = commandPtr->showMiss = true ;
@@ -271,7 +720,15 @@ int main(int argc, char* argv[]) {
                         }
                         break;
                     case 'v':
-                        commandPtr->verbose = true;
+                        if (parser.validOption("verbose", cmdName)) {
+                            commandPtr->verbose = true;
+                        }
+                        break;
+                    case 'x':
+                        if (parser.validOption("xdev", cmdName)) {
+                            commandPtr->xdev = true;
+                        }
+                        break;
                     default:
                         parser.showUnknown(argStr);
                     }
@@ -286,38 +743,110 @@ int main(int argc, char* argv[]) {
             }
         }
 
+        // -0 alone reads the list from stdin.
+        if (listDelim == '\0' && filesFrom.empty()
+                && (fileDirList.empty() || (fileDirList.size() == 1 && fileDirList[0] == "-")))
+            filesFrom = "-";
+        bool listInput = ! filesFrom.empty() || ! manifests.empty();
+        StringList beginList = fileDirList;
+        if (listInput && beginList.empty())
+            beginList.push_back(filesFrom.empty() ? manifests[0] : filesFrom);
+
+        // With -followLinks every root is marked first, a link into another root
+        // is not walked, the root is listed once by its own walk.
+        VisitedSet visited;
+        if (commandPtr->followLinks) {
+            struct stat rootStat;
+            for (const lstring& dir : fileDirList) {
+                if (stat(dir, &rootStat) == 0 && S_ISDIR(rootStat.st_mode))
+                    visited.visit((uint64_t)rootStat.st_dev, (uint64_t)rootStat.st_ino);
+            }
+        }
+
         time_t startT;
         std::cerr << Colors::colorize("_G_ +Start ") << ParseUtil::fmtDateTime(timeStr, startT) << Colors::colorize("_X_\n");
 
-        if (commandPtr->begin(fileDirList)) {
+        // Merge each pattern list into one matcher before the walk.
+        commandPtr->includeFilePatList.compile();
+        commandPtr->excludeFilePatList.compile();
+        commandPtr->includeDirPatList.compile();
+        commandPtr->excludeDirPatList.compile();
 
-            if (parser.patternErrCnt == 0 && parser.optionErrCnt == 0 && fileDirList.size() != 0) {
-                if (fileDirList.size() == 1 && fileDirList[0] == "-") {
+        if (commandPtr->begin(beginList)) {
+            bool scanMode = false;      // DupScan summary includes the pruned count
+
+            if (parser.patternErrCnt == 0 && parser.optionErrCnt == 0 && beginList.size() != 0) {
+                if (listInput) {
+                    // Manifest and listed files mix with any trees given on the command line.
+                    lstring manifestDir;
+                    for (const lstring& manifest : manifests) {
+                        FileListReader reader(manifest, '\n');
+                        DirUtil::getDir(manifestDir, manifest);
+                        DirUtil::fullPath(manifestDir, manifestDir.empty() ? lstring(".") : manifestDir);
+                        if (reader.isOpen())
+                            std::cerr << "  Files Checked=" << InspectFileList(*commandPtr, reader, manifestDir) << std::endl;
+                        else
+                            std::cerr << Colors::colorize("_R_Unable to read ") << manifest << Colors::colorize("_X_\n");
+                    }
+                    if (! filesFrom.empty()) {
+                        FileListReader reader(filesFrom, listDelim);
+                        if (reader.isOpen())
+                            std::cerr << "  Files Checked=" << InspectFileList(*commandPtr, reader) << std::endl;
+                        else
+                            std::cerr << Colors::colorize("_R_Unable to read ") << filesFrom << Colors::colorize("_X_\n");
+                    }
+                    for (auto const& filePath : fileDirList) {
+                        if (filePath != "-")
+                            std::cerr << "  Files Checked=" << InspectFiles(*commandPtr, filePath, visited) << std::endl;
+                    }
+                } else if (fileDirList.size() == 1
+                        && (! commandPtr->writeManifest.empty() || ! commandPtr->verifyManifest.empty())) {
+                    DupScan dupScan(*commandPtr);
+                    scanMode = true;
+                    if (! commandPtr->writeManifest.empty()) {
+                        std::cerr << "  Manifest Files=" << dupScan.writeManifest(fileDirList[0], commandPtr->writeManifest)
+                            << " Pruned=" << commandPtr->pruneCnt
+                            << std::endl;
+                    } else {
+                        size_t fileCnt = dupScan.verifyManifest(fileDirList[0], commandPtr->verifyManifest);
+                        std::cerr << "_Dup=" << commandPtr->sameCnt
+                            << " Diff=" << commandPtr->diffCnt
+                            << " Miss=" << commandPtr->missCnt
+                            << " Quick=" << commandPtr->quickCnt
+                            << " Pruned=" << commandPtr->pruneCnt
+                            << " Files=" << fileCnt
+                            << std::endl;
+                    }
+                } else if (fileDirList.size() == 1 && fileDirList[0] == "-") {
                     string filePath;
                     while (std::getline(std::cin, filePath)) {
-                        std::cerr << "  Files Checked=" << InspectFiles(*commandPtr, filePath) << std::endl;
+                        std::cerr << "  Files Checked=" << InspectFiles(*commandPtr, filePath, visited) << std::endl;
                     }
-                } else if (commandPtr->ignoreExtn || ! commandPtr->sameName || fileDirList.size() != 2) {
+                } else if (commandPtr->ignoreExtn || ! commandPtr->sameName || commandPtr->dupDirs
+                        || (fileDirList.size() != 2 && ! (commandPtr->replicas && fileDirList.size() > 2))) {
                     for (auto const& filePath : fileDirList) {
-                        std::cerr << "  Files Checked=" << InspectFiles(*commandPtr, filePath) << std::endl;
+                        std::cerr << "  Files Checked=" << InspectFiles(*commandPtr, filePath, visited) << std::endl;
                     }
-                } else if (fileDirList.size() == 2) {
+                } else {
                     DupScan dupScan(*commandPtr);
-                    StringSet nextDirList;
-                    nextDirList.insert("");
-                    unsigned level = 0;
-                    while (dupScan.findDuplicates(level, fileDirList, nextDirList)) {
-                        level++;
-                    }
+                    scanMode = true;
+                    unsigned level = dupScan.findDuplicates(fileDirList);
                     std::cerr << "_Levels=" << level
                         << " Dup=" << commandPtr->sameCnt
                         << " Diff=" << commandPtr->diffCnt
                         << " Miss=" << commandPtr->missCnt
+                        << " MissDirs=" << commandPtr->missDirCnt
+                        << " Moved=" << commandPtr->moveCnt
+                        << " Quick=" << commandPtr->quickCnt
+                        << " SameDirs=" << commandPtr->sameDirCnt
                         << " Skip=" << commandPtr->skipCnt
+                        << " Pruned=" << commandPtr->pruneCnt
                         << " Files=" << commandPtr->sameCnt + commandPtr->diffCnt + commandPtr->missCnt + commandPtr->skipCnt
                         << std::endl;
                 }
             }
+            if (commandPtr->pruneCnt != 0 && ! scanMode)
+                std::cerr << "  Pruned dirs=" << commandPtr->pruneCnt << std::endl;
 
             commandPtr->end();
         }
@@ -53,12 +53,12 @@ public:
 
     lstring(const lstring& rhs) : std::string(rhs)
     { }
-    lstring(const lstring&& rhs) noexcept  : std::string(rhs)
+    lstring(lstring&& rhs) noexcept  : std::string(std::move(rhs))
     { }
 
     lstring(const std::string& rhs) : std::string(rhs)
     { }
-    lstring(const std::string&& rhs) : std::string(rhs)
+    lstring(std::string&& rhs) noexcept : std::string(std::move(rhs))
     { }
 
     std::string& toString()
@@ -97,6 +97,10 @@ public:
         this->assign(rhs);
         return *this;
     }
+    lstring& operator=(lstring&& rhs) noexcept {
+        std::string::operator=(std::move(rhs));
+        return *this;
+    }
 
     lstring& toLower() {
         transform(begin(), end(), begin(),::tolower);
@@ -0,0 +1,339 @@
+//-------------------------------------------------------------------------------------------------
+//
+// File: manifest.cpp   Author: Dennis Lang  Desc: Parse checksum manifests.
+//
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2024
+// https://landenlabs.com
+//
+// This file is part of lldup project.
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "manifest.hpp"
+
+#include <iostream>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+// ---------------------------------------------------------------------------
+HashKind Manifest::kindOf(const char* tag, size_t tagLen) {
+    static const struct { const char* tag; HashKind kind; } TAGS[] = {
+        { "XXH64", HASH_XXH64 }, { "XXH32", HASH_XXH32 }, { "XXH3", HASH_XXH3 },
+        { "XXH128", HASH_XXH128 }, { "MD5", HASH_MD5 }, { "SHA1", HASH_SHA1 },
+        { "SHA224", HASH_SHA224 }, { "SHA256", HASH_SHA256 }, { "SHA384", HASH_SHA384 },
+        { "SHA512", HASH_SHA512 },
+    };
+    for (const auto& item : TAGS) {
+        if (strlen(item.tag) == tagLen && strncmp(item.tag, tag, tagLen) == 0)
+            return item.kind;
+    }
+    return HASH_NONE;
+}
+
+// ---------------------------------------------------------------------------
+// 32 digits is taken as MD5, an XXH128 manifest is only told apart by its BSD tag.
+HashKind Manifest::kindOf(size_t hexLen) {
+    switch (hexLen) {
+    case 8:   return HASH_XXH32;
+    case 16:  return HASH_XXH64;
+    case 32:  return HASH_MD5;
+    case 40:  return HASH_SHA1;
+    case 56:  return HASH_SHA224;
+    case 64:  return HASH_SHA256;
+    case 96:  return HASH_SHA384;
+    case 128: return HASH_SHA512;
+    }
+    return HASH_NONE;
+}
+
+// ---------------------------------------------------------------------------
+bool Manifest::foldHex(const char* hex, size_t hexLen, uint64_t& outHash) {
+    outHash = 0;
+    uint64_t word = 0;
+    for (size_t idx = 0; idx < hexLen; idx++) {
+        int chr = tolower((unsigned char)hex[idx]);
+        if (chr >= '0' && chr <= '9')
+            word = (word << 4) | (chr - '0');
+        else if (chr >= 'a' && chr <= 'f')
+            word = (word << 4) | (chr - 'a' + 10);
+        else
+            return false;
+        if (idx % 16 == 15 || idx + 1 == hexLen) {
+            outHash ^= word;
+            word = 0;
+        }
+    }
+    return hexLen != 0;
+}
+
+// ---------------------------------------------------------------------------
+// Undo GNU escapes in place, \\ and \n (also \r) in names holding those characters.
+static void unescape(char* str) {
+    char* out = str;
+    for (const char* in = str; *in != '\0'; in++) {
+        if (*in == '\\' && in[1] != '\0') {
+            in++;
+            *out++ = (*in == 'n') ? '\n' : (*in == 'r') ? '\r' : *in;
+        } else {
+            *out++ = *in;
+        }
+    }
+    *out = '\0';
+}
+
+// ---------------------------------------------------------------------------
+bool Manifest::parseLine(char* line, ManifestLine& out) {
+    bool escaped = (*line == '\\');
+    if (escaped)
+        line++;
+    if (*line == '\0' || *line == '#')
+        return false;
+
+    out.size = FileStore::NO_SIZE;
+    out.mtime = 0;
+    size_t hexLen = strspn(line, "0123456789abcdefABCDEF");
+    const char* tagEnd = line + strcspn(line, " (");
+    if (strncmp(tagEnd, " (", 2) == 0 && (hexLen == 0 || line + hexLen < tagEnd)) {
+        // BSD: TAG (path) = hex
+        out.kind = kindOf(line, tagEnd - line);
+        char* pathPtr = (char*)tagEnd + 2;
+        char* hexPtr = strrchr(pathPtr, '=');
+        if (out.kind == HASH_NONE || hexPtr == nullptr || hexPtr - pathPtr < 2 || strncmp(hexPtr - 2, ") ", 2) != 0)
+            return false;
+        hexPtr[-2] = '\0';
+        hexPtr += strspn(hexPtr + 1, " ") + 1;
+        hexLen = strspn(hexPtr, "0123456789abcdefABCDEF");
+        if (! foldHex(hexPtr, hexLen, out.hash))
+            return false;
+        out.path = pathPtr;
+    } else {
+        // GNU: [XXH3_]hex, optional size, two separator characters, path
+        char* hexPtr = line;
+        bool isXxh3 = strncmp(hexPtr, "XXH3_", 5) == 0;
+        if (isXxh3) {
+            hexPtr += 5;
+            hexLen = strspn(hexPtr, "0123456789abcdefABCDEF");
+        }
+        out.kind = isXxh3 ? HASH_XXH3 : kindOf(hexLen);
+        char* rest = hexPtr + hexLen;
+        if (out.kind == HASH_NONE || *rest != ' ' || ! foldHex(hexPtr, hexLen, out.hash))
+            return false;
+        if (isdigit((unsigned char)rest[1])) {
+            char* numEnd;
+            out.size = strtoull(rest + 1, &numEnd, 10);
+            rest = numEnd;
+            if (*rest == ' ' && (isdigit((unsigned char)rest[1]) || rest[1] == '-')) {
+                out.mtime = (time_t)strtoll(rest + 1, &numEnd, 10);
+                rest = numEnd;
+            }
+            if (*rest != ' ')
+                return false;
+        }
+        if (rest[1] != ' ' && rest[1] != '*')
+            return false;
+        out.path = rest + 2;
+    }
+
+    if (escaped)
+        unescape((char*)out.path);
+    return *out.path != '\0';
+}
+
+// ---------------------------------------------------------------------------
+const char TreeManifest::MAGIC[8] = { 'L', 'L', 'D', 'U', 'P', 'M', 'F', '1' };
+
+static void putVarint(std::string& buf, uint64_t value) {
+    while (value >= 0x80) {
+        buf += (char)(value | 0x80);
+        value >>= 7;
+    }
+    buf += (char)value;
+}
+
+static bool getVarint(const char*& ptr, const char* endPtr, uint64_t& value) {
+    value = 0;
+    for (unsigned shift = 0; ptr < endPtr && shift < 64; shift += 7) {
+        uint8_t byte = (uint8_t)*ptr++;
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+// ---------------------------------------------------------------------------
+bool TreeManifest::create(const lstring& manifestPath) {
+    size_t len = manifestPath.length();
+    isText = len > 4 && manifestPath.compare(len - 4, 4, ".txt") == 0;
+    out = fopen(manifestPath.c_str(), isText ? "w" : "wb");
+    if (out == nullptr)
+        return false;
+    if (! isText)
+        fwrite(MAGIC, 1, sizeof(MAGIC), out);
+    lastPath.clear();
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+void TreeManifest::write(std::string_view relPath, uint64_t size, time_t mtime, uint64_t hash) {
+    if (isText) {
+        // Same escaping as the GNU tools, a name holding \ or a newline starts with \.
+        bool escape = relPath.find_first_of("\\\n") != std::string_view::npos;
+        char head[80];
+        snprintf(head, sizeof(head), "%s%016llx %llu %lld  ", escape ? "\\" : "",
+            (unsigned long long)hash, (unsigned long long)size, (long long)mtime);
+        outBuf += head;
+        for (char chr : relPath) {
+            if (escape && chr == '\\')
+                outBuf += "\\\\";
+            else if (escape && chr == '\n')
+                outBuf += "\\n";
+            else
+                outBuf += chr;
+        }
+        outBuf += '\n';
+    } else {
+        size_t prefix = 0;
+        while (prefix < lastPath.length() && prefix < relPath.length() && lastPath[prefix] == relPath[prefix])
+            prefix++;
+        putVarint(outBuf, prefix);
+        putVarint(outBuf, relPath.length() - prefix);
+        outBuf.append(relPath.data() + prefix, relPath.length() - prefix);
+        putVarint(outBuf, size);
+        int64_t time64 = (int64_t)mtime;
+        putVarint(outBuf, ((uint64_t)time64 << 1) ^ (uint64_t)(time64 >> 63));
+        for (unsigned byte = 0; byte < 8; byte++)
+            outBuf += (char)(hash >> (byte * 8));
+        lastPath.assign(relPath);
+    }
+    if (outBuf.length() >= (1 << 20)) {
+        fwrite(outBuf.data(), 1, outBuf.length(), out);
+        outBuf.clear();
+    }
+}
+
+// ---------------------------------------------------------------------------
+bool TreeManifest::close() {
+    if (out == nullptr)
+        return false;
+    fwrite(outBuf.data(), 1, outBuf.length(), out);
+    outBuf.clear();
+    bool isGood = ferror(out) == 0;
+    isGood &= fclose(out) == 0;
+    out = nullptr;
+    return isGood;
+}
+
+// ---------------------------------------------------------------------------
+bool TreeManifest::load(const lstring& manifestPath) {
+    FILE* in = fopen(manifestPath.c_str(), "rb");
+    if (in == nullptr)
+        return false;
+    std::vector<char> data;
+    char buffer[1 << 16];
+    size_t got;
+    while ((got = fread(buffer, 1, sizeof(buffer), in)) != 0)
+        data.insert(data.end(), buffer, buffer + got);
+    fclose(in);
+
+    records.clear();
+    byPath.clear();
+    if (data.size() >= sizeof(MAGIC) && memcmp(data.data(), MAGIC, sizeof(MAGIC)) == 0)
+        return loadBinary(data.data() + sizeof(MAGIC), data.size() - sizeof(MAGIC));
+    return loadText(data);
+}
+
+// ---------------------------------------------------------------------------
+bool TreeManifest::loadBinary(const char* data, size_t len) {
+    const char* ptr = data;
+    const char* endPtr = data + len;
+    std::string path;
+    while (ptr < endPtr) {
+        uint64_t prefix, suffix, size, time64;
+        if (! getVarint(ptr, endPtr, prefix) || ! getVarint(ptr, endPtr, suffix)
+            || prefix > path.length() || suffix > (uint64_t)(endPtr - ptr))
+            return false;
+        path.resize(prefix);
+        path.append(ptr, suffix);
+        ptr += suffix;
+        if (! getVarint(ptr, endPtr, size) || ! getVarint(ptr, endPtr, time64) || endPtr - ptr < 8)
+            return false;
+        uint64_t hash = 0;
+        for (unsigned byte = 0; byte < 8; byte++)
+            hash |= (uint64_t)(uint8_t)*ptr++ << (byte * 8);
+        addRecord(path.c_str(), path.length(), size, (time_t)((time64 >> 1) ^ (0 - (time64 & 1))), hash);
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// xxhsum style lines, only XXH64 hashes can be compared to the live tree.
+bool TreeManifest::loadText(std::vector<char>& data) {
+    data.push_back('\n');
+    size_t skipCnt = 0;
+    ManifestLine line;
+    char* linePtr = data.data();
+    for (char* endPtr; (endPtr = (char*)memchr(linePtr, '\n', data.data() + data.size() - linePtr)) != nullptr; linePtr = endPtr + 1) {
+        *endPtr = '\0';
+        if (endPtr != linePtr && endPtr[-1] == '\r')
+            endPtr[-1] = '\0';
+        if (! Manifest::parseLine(linePtr, line))
+            continue;
+        if (line.kind != HASH_XXH64) {
+            skipCnt++;
+            continue;
+        }
+        char* path = (char*)line.path;
+#ifdef HAVE_WIN
+        for (char* chr = path; *chr != '\0'; chr++) {
+            if (*chr == '\\')
+                *chr = '/';
+        }
+#endif
+        while (path[0] == '.' && path[1] == '/')
+            path += 2;
+        addRecord(path, strlen(path), line.size, line.mtime, line.hash);
+    }
+    if (skipCnt != 0)
+        std::cerr << "  Manifest lines without XXH64 skipped=" << skipCnt << std::endl;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+void TreeManifest::addRecord(const char* path, size_t len, uint64_t size, time_t mtime, uint64_t hash) {
+    ManifestRecord record;
+    record.path = std::string_view(arena.copy(path, len), len);
+    record.size = size;
+    record.mtime = mtime;
+    record.hash = hash;
+    byPath[record.path] = (uint32_t)records.size();
+    records.push_back(record);
+}
+
+// ---------------------------------------------------------------------------
+ManifestRecord* TreeManifest::find(std::string_view relPath) {
+    auto iter = byPath.find(relPath);
+    return (iter != byPath.end()) ? &records[iter->second] : nullptr;
+}
@@ -0,0 +1,124 @@
+//-------------------------------------------------------------------------------------------------
+// File: manifest.hpp    Author: Dennis Lang
+//
+// Desc: Checksum manifests written by xxhsum, md5sum, sha1sum, sha256sum ...
+//
+//      <hex>  <path>           GNU style, ' *' instead of two spaces for binary mode
+//      \<hex>  <path>          path with \n or \\ escapes
+//      <hex> <size>  <path>    with file length, read without a stat
+//      <hex> <size> <mtime>  <path>    text tree manifest written by -writeManifest
+//      SHA256 (<path>) = <hex> BSD style (--tag)
+//
+//   Hashes wider than 64 bits are folded (xor of 64 bit words), so equal content still
+//   gives equal hashes of the same kind. A GNU line's kind comes from its hex length,
+//   16 hex digits are XXH64 and match the hashes lldup computes.
+//
+//   TreeManifest - relative path, size, modify time and XXH64 of every file of a tree,
+//                  written by -writeManifest and compared to a live tree by -verifyManifest.
+//                  Binary unless the file name ends with .txt.
+//
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2024
+// https://landenlabs.com
+//
+// This file is part of lldup project.
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#include "ll_stdhdr.hpp"
+#include "filestore.hpp"
+#include "arena.hpp"
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <stdint.h>
+#include <time.h>
+
+// One parsed manifest line, path points into the line.
+class ManifestLine {
+public:
+    const char* path = nullptr;
+    uint64_t hash = 0;
+    HashKind kind = HASH_NONE;
+    uint64_t size = FileStore::NO_SIZE;     // NO_SIZE unless the line has a size column
+    time_t mtime = 0;                       // 0 unless the line has a modify time column
+};
+
+namespace Manifest {
+    // Parse one line, the path is unescaped in place. False for comments, blank or
+    // unknown lines.
+    bool parseLine(char* line, ManifestLine& out);
+
+    // Return kind named by a BSD tag, ex: "SHA256", or from the digits of a GNU line.
+    HashKind kindOf(const char* tag, size_t tagLen);
+    HashKind kindOf(size_t hexLen);
+
+    // Fold hexLen hex digits to 64 bits, false if not hex.
+    bool foldHex(const char* hex, size_t hexLen, uint64_t& outHash);
+}
+
+// File of a tree manifest, path relative to the tree root with '/' separators.
+class ManifestRecord {
+public:
+    std::string_view path;
+    uint64_t size;
+    time_t   mtime;
+    uint64_t hash;
+    bool     seen = false;      // matched by a live file during verify
+};
+
+// Binary layout after the "LLDUPMF1" magic, per file in walk order:
+//      varint prefix length shared with the previous path, varint suffix length, suffix,
+//      varint size, zigzag varint mtime, 8 byte little endian XXH64
+class TreeManifest {
+public:
+    std::vector<ManifestRecord> records;
+
+    // Writing, records are streamed, nothing is kept.
+    bool create(const lstring& manifestPath);
+    void write(std::string_view relPath, uint64_t size, time_t mtime, uint64_t hash);
+    bool close();
+
+    // Reading, binary or text detected from the content.
+    bool load(const lstring& manifestPath);
+    ManifestRecord* find(std::string_view relPath);
+
+private:
+    static const char MAGIC[8];
+
+    FILE* out = nullptr;
+    bool isText = false;
+    std::string outBuf;         // records waiting to be written
+    std::string lastPath;       // previous path, binary paths share its prefix
+
+    Arena arena;                // loaded paths
+    std::unordered_map<std::string_view, uint32_t> byPath;     // record index
+
+    bool loadBinary(const char* data, size_t len);
+    bool loadText(std::vector<char>& data);
+    void addRecord(const char* path, size_t len, uint64_t size, time_t mtime, uint64_t hash);
+};
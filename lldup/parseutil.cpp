@@ -48,10 +48,12 @@ void ParseUtil::showUnknown(const char* argStr) {
 
 // ---------------------------------------------------------------------------
 // Return compiled regular expression from text.
-std::regex ParseUtil::getRegEx(const char* value) {
+// Compile value, source gets the expression after escape conversion.
+std::regex ParseUtil::getRegEx(const char* value, std::string& source) {
     try {
         lstring valueStr(value);
-        convertSpecialChar(valueStr);
+        valueStr.resize(strlen(convertSpecialChar(valueStr)));
+        source = valueStr;
         return ignoreCase ? std::regex(valueStr, regex_constants::icase) : std::regex(valueStr);
     } catch (const std::regex_error& regEx) {
         Colors::showError("Invalid regular expression ", regEx.what(), ", Pattern=", value);
@@ -60,6 +62,7 @@ std::regex ParseUtil::getRegEx(const char* value) {
     }
 
     patternErrCnt++;
+    source.clear();
     return std::regex("");
 }
 
@@ -86,6 +89,11 @@ bool ParseUtil::validOption(const char* validCmd, const char* possibleCmd, bool
 bool ParseUtil::validPattern(PatternList& outList, lstring& value, const char* validCmd, const char* possibleCmd, bool reportErr) {
     bool isOk = validOption(validCmd, possibleCmd, reportErr);
     if (isOk) {
+        if (!unixRegEx && !ignoreCase && FilePattern::isSimpleGlob(value)) {
+            // Plain DOS glob, matched without regex.
+            outList.addGlob(value);
+            return isOk;
+        }
         if (!unixRegEx) {
             // Convert simple DOS patterns to regular expression
             //  .   -> [.]    // match on dot
@@ -95,7 +103,61 @@ bool ParseUtil::validPattern(PatternList& outList, lstring& value, const char* v
             ReplaceAll(value, "*", ".*");
             ReplaceAll(value, "?", ".");
         }
-        outList.push_back(getRegEx(value));
+        std::string source;
+        std::regex regex = getRegEx(value, source);
+        outList.addRegex(regex, source, ignoreCase);
+    }
+    return isOk;
+}
+
+//-------------------------------------------------------------------------------------------------
+// Load include and exclude patterns from a file, one per line:
+//      # comment
+//      includeFile=<pattern>
+//      excludeFile=<pattern>
+//      includeDir=<pattern>
+//      excludeDir=<pattern>
+//      <pattern>                   same as excludeFile=<pattern>
+bool ParseUtil::validPatternFile(
+          PatternList& includeFileList,
+          PatternList& excludeFileList,
+          PatternList& includeDirList,
+          PatternList& excludeDirList,
+          const lstring& value,
+          const char* validCmd,
+          const char* possibleCmd,
+          bool reportErr) {
+    bool isOk = validOption(validCmd, possibleCmd, reportErr);
+    if (isOk) {
+        std::ifstream in(value);
+        if (! in) {
+            Colors::showError("Failed to open ", validCmd, " ", value, " ", strerror(errno));
+            optionErrCnt++;
+            return isOk;
+        }
+
+        std::string line;
+        while (std::getline(in, line)) {
+            lstring pattern(line);
+            if (! pattern.empty() && pattern.back() == '\r')
+                pattern.pop_back();
+            pattern.trim();
+            if (pattern.empty() || pattern[0] == '#')
+                continue;
+
+            size_t eqPos = pattern.find('=');
+            if (eqPos == lstring::npos) {
+                validPattern(excludeFileList, pattern, "excludeFile", "excludeFile");
+                continue;
+            }
+            lstring key = pattern.substr(0, eqPos);
+            lstring keyValue = pattern.substr(eqPos + 1);
+            const char* keyName = key.c_str() + strspn(key, "-");
+            if (! validPattern(includeFileList, keyValue, "includeFile", keyName, false)
+                    && ! validPattern(includeDirList, keyValue, "includeDir", keyName, false)
+                    && ! validPattern(excludeFileList, keyValue, "excludeFile", keyName, false))
+                validPattern(excludeDirList, keyValue, "excludeDir", keyName);
+        }
     }
     return isOk;
 }
@@ -127,12 +189,7 @@ bool ParseUtil::validFile(
 bool ParseUtil::FileMatches(const lstring& inName, const PatternList& patternList, bool emptyResult) {
     if (patternList.empty() || inName.empty())
         return emptyResult;
-
-    for (size_t idx = 0; idx != patternList.size(); idx++)
-        if (std::regex_match(inName.begin(), inName.end(), patternList[idx]))
-            return true;
-
-    return false;
+    return patternList.matches(inName);
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -33,13 +33,12 @@
 // CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "ll_stdhdr.hpp"
+#include "patterns.hpp"
 
 #include <regex>
 #include <set>
 #include <iostream>
 
-typedef std::vector<std::regex> PatternList;
-
 //-------------------------------------------------------------------------------------------------
 class ParseUtil {
     
@@ -52,10 +51,12 @@ public:
 
     void showUnknown(const char* argStr);
 
-    std::regex getRegEx(const char* value);
+    std::regex getRegEx(const char* value, std::string& source);
 
     bool validOption(const char* validCmd, const char* possibleCmd, bool reportErr = true);
     bool validPattern(PatternList& outList, lstring& value, const char* validCmd, const char* possibleCmd, bool reportErr = true);
+    bool validPatternFile(PatternList& includeFileList, PatternList& excludeFileList,
+            PatternList& includeDirList, PatternList& excludeDirList, const lstring& value, const char* validCmd, const char* possibleCmd, bool reportErr = true);
  
     bool validFile(fstream& stream, int mode, const lstring& value, const char* validCmd, const char* possibleCmd, bool reportErr = true);
 
@@ -0,0 +1,352 @@
+//-------------------------------------------------------------------------------------------------
+//
+// File: patterns.cpp   Author: Dennis Lang  Desc: Compiled file name patterns.
+//
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2024
+// https://landenlabs.com
+//
+// This file is part of lldup project.
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "patterns.hpp"
+
+#include <algorithm>
+#include <ctype.h>
+#include <ctype.h>
+#include <string.h>
+
+// ---------------------------------------------------------------------------
+bool FilePattern::matches(std::string_view name) const {
+    switch (kind) {
+    case EXACT:
+        return name == text;
+    case PREFIX:
+        return name.length() >= text.length() && name.compare(0, text.length(), text) == 0;
+    case EXTN:      // *.<ext> is a suffix
+    case SUFFIX:
+        return name.length() >= text.length() && name.compare(name.length() - text.length(), text.length(), text) == 0;
+    case GLOB:
+        return globMatch(text, name);
+    case REGEX:
+        return std::regex_match(name.begin(), name.end(), regex);
+    }
+    return false;
+}
+
+// ---------------------------------------------------------------------------
+// Single pass with one resume point, on a mismatch the most recent '*' absorbs one
+// more character, so there is no recursion and no exponential backtracking.
+// [static]
+bool FilePattern::globMatch(std::string_view glob, std::string_view name) {
+    size_t gIdx = 0, nIdx = 0;
+    size_t starIdx = std::string_view::npos;
+    size_t resumeIdx = 0;
+
+    while (nIdx < name.length()) {
+        if (gIdx < glob.length() && (glob[gIdx] == '?' || glob[gIdx] == name[nIdx])) {
+            gIdx++;
+            nIdx++;
+        } else if (gIdx < glob.length() && glob[gIdx] == '*') {
+            starIdx = gIdx++;
+            resumeIdx = nIdx;
+        } else if (starIdx != std::string_view::npos) {
+            gIdx = starIdx + 1;
+            nIdx = ++resumeIdx;
+        } else {
+            return false;
+        }
+    }
+    while (gIdx < glob.length() && glob[gIdx] == '*')
+        gIdx++;
+    return gIdx == glob.length();
+}
+
+// ---------------------------------------------------------------------------
+// [static]
+bool FilePattern::isSimpleGlob(const char* glob) {
+    return *glob != '\0' && strpbrk(glob, "[](){}|+^$\\") == nullptr;
+}
+
+// ---------------------------------------------------------------------------
+void PatternList::addGlob(const std::string& glob) {
+    size_t firstWild = glob.find_first_of("*?");
+    size_t lastStar = glob.rfind('*');
+
+    if (firstWild == std::string::npos) {
+        patterns.emplace_back(FilePattern::EXACT, glob);
+    } else if (firstWild == 0 && glob[0] == '*' && glob.find_first_of("*?", 1) == std::string::npos) {
+        std::string suffix = glob.substr(1);
+        bool isExtn = suffix.length() > 1 && suffix[0] == '.' && suffix.find('.', 1) == std::string::npos;
+        patterns.emplace_back(isExtn ? FilePattern::EXTN : FilePattern::SUFFIX, suffix);
+    } else if (glob[firstWild] == '*' && lastStar == firstWild && firstWild + 1 == glob.length()) {
+        patterns.emplace_back(FilePattern::PREFIX, glob.substr(0, firstWild));
+    } else {
+        patterns.emplace_back(FilePattern::GLOB, glob);
+    }
+    compiled.reset();
+}
+
+// ---------------------------------------------------------------------------
+bool PatternList::matches(std::string_view name) const {
+    if (compiled)
+        return compiled->matches(name);
+    for (const FilePattern& pattern : patterns) {
+        if (pattern.matches(name))
+            return true;
+    }
+    return false;
+}
+
+const int32_t LiteralAutomaton::DEAD;
+
+// ---------------------------------------------------------------------------
+void LiteralAutomaton::add(std::string_view literal, uint32_t id) {
+    literals.emplace_back(literal);
+    literalIds.push_back(id);
+    for (unsigned char chr : literal) {
+        if (byteClass[chr] == 0)
+            byteClass[chr] = (uint16_t)classCnt++;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Trie of the literals, with anywhere the missing edges are filled from the failure
+// links (Aho-Corasick) and each state also outputs the literals ending at its suffixes.
+void LiteralAutomaton::build(bool anywhere) {
+    delta.assign(classCnt, DEAD);
+    outputs.assign(1, std::vector<uint32_t>());
+    for (size_t idx = 0; idx < literals.size(); idx++) {
+        int32_t state = 0;
+        for (unsigned char chr : literals[idx]) {
+            int32_t& edge = delta[state * classCnt + byteClass[chr]];
+            if (edge == DEAD) {
+                edge = (int32_t)outputs.size();
+                outputs.emplace_back();
+                delta.resize(delta.size() + classCnt, DEAD);
+            }
+            state = delta[state * classCnt + byteClass[chr]];
+        }
+        outputs[state].push_back(literalIds[idx]);
+    }
+
+    if (anywhere) {
+        std::vector<int32_t> fail(outputs.size(), 0);
+        std::vector<int32_t> queue(1, 0);
+        for (size_t qIdx = 0; qIdx < queue.size(); qIdx++) {
+            int32_t state = queue[qIdx];
+            for (unsigned cls = 0; cls < classCnt; cls++) {
+                int32_t& edge = delta[state * classCnt + cls];
+                int32_t failEdge = (state == 0) ? 0 : delta[fail[state] * classCnt + cls];
+                if (edge == DEAD) {
+                    edge = failEdge;
+                } else {
+                    fail[edge] = failEdge;
+                    const std::vector<uint32_t>& inherit = outputs[failEdge];
+                    outputs[edge].insert(outputs[edge].end(), inherit.begin(), inherit.end());
+                    queue.push_back(edge);
+                }
+            }
+        }
+    }
+    std::vector<std::string>().swap(literals);
+    std::vector<uint32_t>().swap(literalIds);
+}
+
+// ---------------------------------------------------------------------------
+// Longest run of characters without a wildcard.
+static std::string_view longestLiteral(std::string_view glob) {
+    std::string_view best;
+    size_t pos = 0;
+    while (pos < glob.length()) {
+        size_t endPos = glob.find_first_of("*?", pos);
+        if (endPos == std::string_view::npos)
+            endPos = glob.length();
+        if (endPos - pos > best.length())
+            best = glob.substr(pos, endPos - pos);
+        pos = endPos + 1;
+    }
+    return best;
+}
+
+// ---------------------------------------------------------------------------
+// Glob as regular expression source, '*' to '.*', '?' to '.' and other
+// characters escaped.
+static std::string globToRegex(std::string_view glob) {
+    std::string out;
+    for (char chr : glob) {
+        if (chr == '*')
+            out += ".*";
+        else if (chr == '?')
+            out += '.';
+        else {
+            if (strchr(".^$|()[]{}+\\", chr) != nullptr)
+                out += '\\';
+            out += chr;
+        }
+    }
+    return out;
+}
+
+// ---------------------------------------------------------------------------
+// Back references count groups, they break once sources are joined.
+static bool hasBackReference(std::string_view source) {
+    for (size_t pos = 0; pos + 1 < source.length(); pos++) {
+        if (source[pos] == '\\') {
+            if (isdigit((unsigned char)source[pos + 1]) && source[pos + 1] != '0')
+                return true;
+            pos++;
+        }
+    }
+    return false;
+}
+
+// ---------------------------------------------------------------------------
+PatternSet::PatternSet(const std::vector<FilePattern>& _patterns) : patterns(_patterns) {
+    std::hash<std::string_view> hasher;
+    std::string joinSource[2];  // by icase
+    std::vector<uint32_t> joinIds[2];
+    for (uint32_t id = 0; id < patterns.size(); id++) {
+        const FilePattern& pattern = patterns[id];
+        std::string_view text = pattern.text;
+        switch (pattern.kind) {
+        case FilePattern::EXACT:
+            exacts.emplace(hasher(text), id);
+            break;
+        case FilePattern::EXTN:
+            extns.emplace(hasher(text.substr(1)), id);
+            maxExtn = std::max(maxExtn, text.length() - 1);
+            break;
+        case FilePattern::PREFIX:
+            if (text.empty())
+                matchAll = true;
+            prefixes.add(text, id);
+            break;
+        case FilePattern::SUFFIX:
+            if (text.empty())
+                matchAll = true;
+            suffixes.add(std::string(text.rbegin(), text.rend()), id);
+            break;
+        case FilePattern::GLOB:
+            if (longestLiteral(text).empty()) {
+                joinSource[0] += (joinSource[0].empty() ? "(?:" : "|(?:") + globToRegex(text) + ")";
+                joinIds[0].push_back(id);
+            } else {
+                globLiterals.add(longestLiteral(text), id);
+            }
+            break;
+        case FilePattern::REGEX:
+            if (text.empty() || hasBackReference(text)) {
+                regexes.push_back(id);
+            } else {
+                joinSource[pattern.icase] += (joinSource[pattern.icase].empty() ? "(?:" : "|(?:") + pattern.text + ")";
+                joinIds[pattern.icase].push_back(id);
+            }
+            break;
+        }
+    }
+    for (unsigned icase = 0; icase < 2; icase++) {
+        if (joinIds[icase].empty())
+            continue;
+        try {
+            joined.emplace_back(joinSource[icase], icase ? std::regex::ECMAScript | std::regex::icase : std::regex::ECMAScript);
+        } catch (const std::regex_error&) {
+            // Patterns which only parse alone, try them one by one.
+            for (uint32_t id : joinIds[icase]) {
+                if (patterns[id].kind == FilePattern::REGEX)
+                    regexes.push_back(id);
+                else
+                    joined.emplace_back(globToRegex(patterns[id].text));
+            }
+        }
+    }
+    prefixes.build(false);
+    suffixes.build(false);
+    globLiterals.build(true);
+}
+
+// ---------------------------------------------------------------------------
+bool PatternSet::matches(std::string_view name) const {
+    if (matchAll)
+        return true;
+
+    std::hash<std::string_view> hasher;
+    if (! exacts.empty()) {
+        auto range = exacts.equal_range(hasher(name));
+        for (auto iter = range.first; iter != range.second; ++iter) {
+            if (patterns[iter->second].text == name)
+                return true;
+        }
+    }
+
+    if (! extns.empty()) {
+        size_t dotPos = name.rfind('.');
+        if (dotPos != std::string_view::npos && name.length() - dotPos - 1 <= maxExtn) {
+            std::string_view extn = name.substr(dotPos + 1);
+            auto range = extns.equal_range(hasher(extn));
+            for (auto iter = range.first; iter != range.second; ++iter) {
+                if (extn == std::string_view(patterns[iter->second].text).substr(1))
+                    return true;
+            }
+        }
+    }
+
+    if (! prefixes.empty()) {
+        int32_t state = 0;
+        for (size_t idx = 0; idx < name.length() && state != LiteralAutomaton::DEAD; idx++) {
+            state = prefixes.next(state, (unsigned char)name[idx]);
+            if (state != LiteralAutomaton::DEAD && ! prefixes.output(state).empty())
+                return true;
+        }
+    }
+
+    if (! suffixes.empty()) {
+        int32_t state = 0;
+        for (size_t idx = name.length(); idx-- != 0 && state != LiteralAutomaton::DEAD; ) {
+            state = suffixes.next(state, (unsigned char)name[idx]);
+            if (state != LiteralAutomaton::DEAD && ! suffixes.output(state).empty())
+                return true;
+        }
+    }
+
+    if (! globLiterals.empty()) {
+        int32_t state = 0;
+        for (unsigned char chr : name) {
+            state = globLiterals.next(state, chr);
+            for (uint32_t id : globLiterals.output(state)) {
+                if (FilePattern::globMatch(patterns[id].text, name))
+                    return true;
+            }
+        }
+    }
+    for (const std::regex& regex : joined) {
+        if (std::regex_match(name.begin(), name.end(), regex))
+            return true;
+    }
+    for (uint32_t id : regexes) {
+        if (patterns[id].matches(name))
+            return true;
+    }
+    return false;
+}
@@ -0,0 +1,166 @@
+//-------------------------------------------------------------------------------------------------
+// File: patterns.hpp    Author: Dennis Lang
+//
+// Desc: File name patterns for -includeFile and -excludeFile, compiled once so a name
+//       is matched without std::regex whenever the pattern is a simple DOS glob.
+//
+//      *.jpg       extension, hashed
+//      abc         exact name, hashed
+//      abc*        prefix, one trie walk covers every prefix pattern
+//      *abc        suffix, one reversed trie walk covers every suffix pattern
+//      a*b?c       glob, an Aho-Corasick pass over the glob literals picks the few
+//                  globs worth running through the single pass wildcard matcher
+//      [a-c].*     anything using regex syntax (or -unix / -ignoreCase) stays std::regex
+//
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2024
+// https://landenlabs.com
+//
+// This file is part of lldup project.
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#include "ll_stdhdr.hpp"
+
+#include <vector>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <memory>
+#include <stdint.h>
+
+// One compiled pattern.
+class FilePattern {
+public:
+    enum Kind { EXACT, EXTN, PREFIX, SUFFIX, GLOB, REGEX };
+
+    Kind kind;
+    std::string text;   // literal part (EXTN includes the dot), glob for GLOB, source for REGEX
+    std::regex regex;   // REGEX only
+    bool icase = false; // REGEX only
+
+    FilePattern(Kind _kind, const std::string& _text) : kind(_kind), text(_text) {}
+    FilePattern(const std::regex& _regex, const std::string& _source, bool _icase)
+        : kind(REGEX), text(_source), regex(_regex), icase(_icase) {}
+
+    bool matches(std::string_view name) const;
+
+    // Glob match, '*' any run and '?' any one character.
+    static bool globMatch(std::string_view glob, std::string_view name);
+    // True if glob only uses literal characters plus * and ?
+    static bool isSimpleGlob(const char* glob);
+};
+
+// Byte automaton over a set of literals. Bytes which appear in no literal share one
+// class so a state row stays small. As a trie it finds literals that start the text,
+// built with anywhere set it is an Aho-Corasick automaton finding them at any offset.
+class LiteralAutomaton {
+public:
+    static const int32_t DEAD = -1;
+
+    void add(std::string_view literal, uint32_t id);
+    void build(bool anywhere);
+
+    bool empty() const {
+        return outputs.size() <= 1 && (outputs.empty() || outputs[0].empty());
+    }
+    int32_t next(int32_t state, unsigned char chr) const {
+        return delta[state * classCnt + byteClass[chr]];
+    }
+    // Ids of literals ending at state.
+    const std::vector<uint32_t>& output(int32_t state) const {
+        return outputs[state];
+    }
+
+private:
+    uint16_t byteClass[256] = {};
+    unsigned classCnt = 1;
+    std::vector<std::string> literals;
+    std::vector<uint32_t> literalIds;
+    std::vector<int32_t> delta;                 // [state * classCnt + class]
+    std::vector<std::vector<uint32_t>> outputs; // by state
+};
+
+// All patterns of a PatternList merged, per name cost depends on the name length and
+// not on the number of patterns. Globs are only tried when the automaton finds their
+// longest literal, globs without a literal and REGEX patterns are joined into one
+// alternation regex per case mode. std::regex still walks the alternatives in turn,
+// so a long list of regular expressions remains slower than the same list of globs.
+class PatternSet {
+public:
+    PatternSet(const std::vector<FilePattern>& patterns);
+
+    bool matches(std::string_view name) const;
+
+private:
+    const std::vector<FilePattern>& patterns;
+    std::unordered_multimap<size_t, uint32_t> exacts;   // hash of name to pattern
+    std::unordered_multimap<size_t, uint32_t> extns;    // hash of extension without dot
+    size_t maxExtn = 0;
+    bool matchAll = false;          // '*' pattern
+    LiteralAutomaton prefixes;
+    LiteralAutomaton suffixes;      // reversed
+    LiteralAutomaton globLiterals;  // longest literal of each glob
+    std::vector<std::regex> joined;     // wild globs and regexes, one per case mode
+    std::vector<uint32_t> regexes;      // regexes with back references, tried alone
+};
+
+// Patterns of one option, a name matches if any pattern matches.
+// compile() merges them into one PatternSet, matching is thread safe.
+class PatternList {
+public:
+    // Add simple glob, classified by its cheapest matcher.
+    void addGlob(const std::string& glob);
+    // Add regular expression, source is kept so PatternSet can join it with others.
+    void addRegex(const std::regex& regex, const std::string& source, bool icase) {
+        patterns.emplace_back(regex, source, icase);
+        compiled.reset();
+    }
+    void compile() {
+        if (! patterns.empty() && ! compiled)
+            compiled = std::make_shared<PatternSet>(patterns);
+    }
+
+    bool empty() const {
+        return patterns.empty();
+    }
+    size_t size() const {
+        return patterns.size();
+    }
+    bool matches(std::string_view name) const;
+
+    PatternList() {}
+    PatternList(const PatternList& other) : patterns(other.patterns) {}
+    PatternList& operator=(const PatternList& other) {
+        patterns = other.patterns;
+        compiled.reset();
+        return *this;
+    }
+
+private:
+    std::vector<FilePattern> patterns;
+    std::shared_ptr<const PatternSet> compiled;   // refers to patterns, dropped on change
+};
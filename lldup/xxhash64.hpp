@@ -139,7 +139,7 @@ public:
         std::ifstream in(filePath, ios::binary | ios::in);
 
         const uint sBufSize = 4096 * 16;
-        static std::vector<char> vBuffer(sBufSize);
+        static thread_local std::vector<char> vBuffer(sBufSize);
         char* buffer = (char*)vBuffer.data();
 
         size_t pos = 0;